@@ -0,0 +1,3 @@
+ALTER TABLE playlists ADD COLUMN smart_playlist_data BLOB;
+
+UPDATE schema_version SET version=5;
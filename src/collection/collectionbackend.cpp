@@ -48,6 +48,7 @@
 #include "sqlrow.h"
 
 const char *CollectionBackend::kSettingsGroup = "Collection";
+const int CollectionBackend::kUrlLookupChunkSize = 500;
 
 CollectionBackend::CollectionBackend(QObject *parent)
     : CollectionBackendInterface(parent)
@@ -732,6 +733,39 @@ SongList CollectionBackend::GetSongsByUrl(const QUrl &url) {
   return songlist;
 }
 
+SongList CollectionBackend::GetSongsByUrls(const QList<QUrl> &urls) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  SongList ret;
+  for (int i = 0 ; i < urls.count() ; i += kUrlLookupChunkSize) {
+    const QList<QUrl> chunk = urls.mid(i, kUrlLookupChunkSize);
+
+    QStringList placeholders;
+    for (int j = 0 ; j < chunk.count() ; ++j) {
+      placeholders << "?";
+    }
+
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE filename IN (%2) AND unavailable = 0").arg(songs_table_, placeholders.join(",")));
+    for (const QUrl &url : chunk) {
+      q.addBindValue(url.toEncoded());
+    }
+    q.exec();
+    if (db_->CheckErrors(q)) return ret;
+
+    while (q.next()) {
+      Song song;
+      song.InitFromQuery(q, true);
+      ret << song;
+    }
+  }
+
+  return ret;
+
+}
+
 CollectionBackend::AlbumList CollectionBackend::GetCompilationAlbums(const QueryOptions &opt) {
   return GetAlbums(QString(), QString(), true, opt);
 }
@@ -1072,6 +1106,7 @@ void CollectionBackend::IncrementPlayCount(int id) {
   if (db_->CheckErrors(q)) return;
 
   Song new_song = GetSongById(id, db);
+  emit SongsStatisticsChanged(SongList() << new_song);
 
 }
 
@@ -1090,6 +1125,7 @@ void CollectionBackend::IncrementSkipCount(int id, float progress) {
   if (db_->CheckErrors(q)) return;
 
   Song new_song = GetSongById(id, db);
+  emit SongsStatisticsChanged(SongList() << new_song);
 
 }
 
@@ -1107,6 +1143,7 @@ void CollectionBackend::ResetStatistics(int id) {
   if (db_->CheckErrors(q)) return;
 
   Song new_song = GetSongById(id, db);
+  emit SongsStatisticsChanged(SongList() << new_song);
 
 }
 
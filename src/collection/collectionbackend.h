@@ -108,6 +108,8 @@ class CollectionBackendInterface : public QObject {
   // Returns a section of a song with the given filename and beginning. If the section is not present in collection, returns invalid song.
   // Using default beginning value is suitable when searching for single-section songs.
   virtual Song GetSongByUrl(const QUrl &url, qint64 beginning = 0) = 0;
+  // Returns all sections of all songs with any of the given filenames.
+  virtual SongList GetSongsByUrls(const QList<QUrl> &urls) = 0;
 
   virtual void AddDirectory(const QString &path) = 0;
   virtual void RemoveDirectory(const Directory &dir) = 0;
@@ -120,6 +122,8 @@ class CollectionBackend : public CollectionBackendInterface {
 
  public:
   static const char *kSettingsGroup;
+  // Number of filenames looked up per query in GetSongsByUrls(), below sqlite's limit on bound values.
+  static const int kUrlLookupChunkSize;
 
   Q_INVOKABLE CollectionBackend(QObject *parent = nullptr);
   void Init(Database *db, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table);
@@ -165,6 +169,7 @@ class CollectionBackend : public CollectionBackendInterface {
 
   SongList GetSongsByUrl(const QUrl &url);
   Song GetSongByUrl(const QUrl &url, qint64 beginning = 0);
+  SongList GetSongsByUrls(const QList<QUrl> &urls);
 
   void AddDirectory(const QString &path);
   void RemoveDirectory(const Directory &dir);
@@ -201,6 +206,8 @@ signals:
 
   void SongsDiscovered(const SongList &songs);
   void SongsDeleted(const SongList &songs);
+  // The play count, skip count or last played time of the songs changed.
+  void SongsStatisticsChanged(const SongList &songs);
 
   void DatabaseReset();
 
@@ -23,6 +23,11 @@
 
 #include "config.h"
 
+#include <memory>
+
+#include <QCollator>
+#include <QString>
+
 #include "core/simpletreeitem.h"
 #include "core/song.h"
 
@@ -47,9 +52,21 @@ class CollectionItem : public SimpleTreeItem<CollectionItem> {
         container_level(-1),
         compilation_artist_node_(nullptr) {}
 
+  // Computes the collation key for SortText(), has to be called again when the sort text changes.
+  void UpdateSortKey(const QCollator &collator) {
+    sort_key.reset(new QCollatorSortKey(collator.sortKey(SortText())));
+  }
+
+  // Compares the precomputed collation keys, falls back to comparing the sort text for items without one.
+  static bool SortKeyLessThan(const CollectionItem *a, const CollectionItem *b) {
+    if (a->sort_key && b->sort_key) return a->sort_key->compare(*b->sort_key) < 0;
+    return QString::localeAwareCompare(a->SortText(), b->SortText()) < 0;
+  }
+
   int container_level;
   Song metadata;
   CollectionItem *compilation_artist_node_;
+  std::unique_ptr<QCollatorSortKey> sort_key;
 };
 
 #endif  // COLLECTIONITEM_H
@@ -57,19 +57,16 @@
 #include "collectiondirectorymodel.h"
 #include "collectionitem.h"
 #include "collectionmodel.h"
+#include "collectionsearchindex.h"
 #include "sqlrow.h"
 #include "playlist/playlistmanager.h"
 #include "playlist/songmimedata.h"
 #include "covermanager/albumcoverloader.h"
 
-using std::bind;
 using std::sort;
-using std::placeholders::_1;
-using std::placeholders::_2;
 
 const char *CollectionModel::kSavedGroupingsSettingsGroup = "SavedGroupings";
 const int CollectionModel::kPrettyCoverSize = 32;
-const qint64 CollectionModel::kIconCacheSize = 100000000;  //~100MB
 
 static bool IsArtistGroupBy(const CollectionModel::GroupBy by) {
   return by == CollectionModel::GroupBy_Artist || by == CollectionModel::GroupBy_AlbumArtist;
@@ -92,6 +89,9 @@ CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, Q
       album_icon_(IconLoader::Load("cdcase")),
       playlists_dir_icon_(IconLoader::Load("folder-sound")),
       playlist_icon_(IconLoader::Load("albums")),
+      search_index_(nullptr),
+      filter_ids_generation_(-1),
+      reset_generation_(0),
       init_task_id_(-1),
       use_pretty_covers_(false),
       show_dividers_(true)
@@ -106,12 +106,10 @@ CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, Q
   cover_loader_options_.desired_height_ = kPrettyCoverSize;
   cover_loader_options_.pad_output_image_ = true;
   cover_loader_options_.scale_output_image_ = true;
+  cover_loader_options_.use_thumbnail_cache_ = true;
 
   connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)), SLOT(AlbumArtLoaded(quint64, QImage)));
 
-  //icon_cache_->setCacheDirectory(Utilities::GetConfigPath(Utilities::Path_CacheRoot) + "/pixmapcache");
-  //icon_cache_->setMaximumCacheSize(CollectionModel::kIconCacheSize);
-
   QIcon nocover = IconLoader::Load("cdcase");
   no_cover_icon_ = nocover.pixmap(nocover.availableSizes().last()).scaled(kPrettyCoverSize, kPrettyCoverSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
   //no_cover_icon_ = QPixmap(":/pictures/noalbumart.png").scaled(kPrettyCoverSize, kPrettyCoverSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
@@ -147,6 +145,23 @@ void CollectionModel::set_show_dividers(bool show_dividers) {
   }
 }
 
+void CollectionModel::set_use_search_index(bool use_search_index) {
+
+  if (use_search_index == (search_index_ != nullptr)) return;
+
+  if (use_search_index) {
+    search_index_ = new CollectionSearchIndex(backend_, this);
+    search_index_->LoadAsync();
+  }
+  else {
+    search_index_->deleteLater();
+    search_index_ = nullptr;
+    query_options_.clear_filter_ids();
+  }
+  filter_ids_generation_ = -1;
+
+}
+
 void CollectionModel::SaveGrouping(QString name) {
 
   qLog(Debug) << "Model, save to: " << name;
@@ -190,7 +205,7 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
     if (!query_options_.Matches(song)) continue;
 
     // Hey, we've already got that one!
-    if (song_nodes_.contains(song.id())) continue;
+    if (tree_.song_nodes.contains(song.id())) continue;
 
     // Before we can add each song we need to make sure the required container items already exist in the tree.
     // These depend on which "group by" settings the user has on the collection.
@@ -205,7 +220,7 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
       // Special case: if the song is a compilation and the current GroupBy level is Artists, then we want the Various Artists node :(
       if (IsArtistGroupBy(type) && song.is_compilation()) {
         if (container->compilation_artist_node_ == nullptr)
-          CreateCompilationArtistNode(true, container);
+          CreateCompilationArtistNode(&tree_, true, container);
         container = container->compilation_artist_node_;
       }
       else {
@@ -250,11 +265,11 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
         }
 
         // Does it exist already?
-        if (!container_nodes_[i].contains(key)) {
+        if (!tree_.container_nodes[i].contains(key)) {
           // Create the container
-          container_nodes_[i][key] = ItemFromSong(type, true, i == 0, container, song, i);
+          tree_.container_nodes[i][key] = ItemFromSong(type, true, i == 0, container, song, i);
         }
-        container = container_nodes_[i][key];
+        container = tree_.container_nodes[i][key];
       }
 
       // If we just created the damn thing then we don't need to continue into it any further because it'll get lazy-loaded properly later.
@@ -263,7 +278,7 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
     if (!container->lazy_loaded) continue;
 
     // We've gone all the way down to the deepest level and everything was already lazy loaded, so now we have to create the song in the container.
-    song_nodes_[song.id()] = ItemFromSong(GroupBy_None, true, false, container, song, -1);
+    tree_.song_nodes[song.id()] = ItemFromSong(GroupBy_None, true, false, container, song, -1);
   }
 
 }
@@ -273,14 +288,14 @@ void CollectionModel::SongsSlightlyChanged(const SongList &songs) {
   // This is called if there was a minor change to the songs that will not normally require the collection to be restructured.
   // We can just update our internal cache of Song objects without worrying about resetting the model.
   for (const Song &song : songs) {
-    if (song_nodes_.contains(song.id())) {
-      song_nodes_[song.id()]->metadata = song;
+    if (tree_.song_nodes.contains(song.id())) {
+      tree_.song_nodes[song.id()]->metadata = song;
     }
   }
 
 }
 
-CollectionItem *CollectionModel::CreateCompilationArtistNode(bool signal, CollectionItem *parent) {
+CollectionItem *CollectionModel::CreateCompilationArtistNode(ItemTree *tree, bool signal, CollectionItem *parent) {
 
   if (signal) beginInsertRows(ItemToIndex(parent), parent->children.count(), parent->children.count());
 
@@ -289,6 +304,7 @@ CollectionItem *CollectionModel::CreateCompilationArtistNode(bool signal, Collec
   parent->compilation_artist_node_->key = tr("Various artists");
   parent->compilation_artist_node_->sort_text = " various";
   parent->compilation_artist_node_->container_level = parent->container_level + 1;
+  parent->compilation_artist_node_->UpdateSortKey(tree->collator);
 
   if (signal) endInsertRows();
 
@@ -400,14 +416,14 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
   // Delete the actual song nodes first, keeping track of each parent so we might check to see if they're empty later.
   QSet<CollectionItem*> parents;
   for (const Song &song : songs) {
-    if (song_nodes_.contains(song.id())) {
-      CollectionItem *node = song_nodes_[song.id()];
+    if (tree_.song_nodes.contains(song.id())) {
+      CollectionItem *node = tree_.song_nodes[song.id()];
 
       if (node->parent != root_) parents << node->parent;
 
       beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
       node->parent->Delete(node->row);
-      song_nodes_.remove(song.id());
+      tree_.song_nodes.remove(song.id());
       endRemoveRows();
     }
     else {
@@ -440,7 +456,7 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
       if (IsCompilationArtistNode(node))
         node->parent->compilation_artist_node_ = nullptr;
       else
-        container_nodes_[node->container_level].remove(node->key);
+        tree_.container_nodes[node->container_level].remove(node->key);
 
       // It was empty - delete it
       beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
@@ -451,11 +467,11 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
 
   // Delete empty dividers
   for (const QString &divider_key : divider_keys) {
-    if (!divider_nodes_.contains(divider_key)) continue;
+    if (!tree_.divider_nodes.contains(divider_key)) continue;
 
     // Look to see if there are any other items still under this divider
     bool found = false;
-    for (CollectionItem *node : container_nodes_[0].values()) {
+    for (CollectionItem *node : tree_.container_nodes[0].values()) {
       if (DividerKey(group_by_[0], node) == divider_key) {
         found = true;
         break;
@@ -465,11 +481,11 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
     if (found) continue;
 
     // Remove the divider
-    int row = divider_nodes_[divider_key]->row;
+    int row = tree_.divider_nodes[divider_key]->row;
     beginRemoveRows(ItemToIndex(root_), row, row);
     root_->Delete(row);
     endRemoveRows();
-    divider_nodes_.remove(divider_key);
+    tree_.divider_nodes.remove(divider_key);
   }
 
 }
@@ -492,7 +508,7 @@ QVariant CollectionModel::AlbumIcon(const QModelIndex &index) {
   CollectionItem *item = IndexToItem(index);
   if (!item) return no_cover_icon_;
 
-  // Check the cache for a pixmap we already loaded.
+  // Check the cache for a pixmap we already loaded.  The scaled covers are kept on disk by the cover loader's thumbnail cache.
   const QString cache_key = AlbumIconPixmapCacheKey(index);
 
   QPixmap cached_pixmap;
@@ -500,20 +516,9 @@ QVariant CollectionModel::AlbumIcon(const QModelIndex &index) {
     return cached_pixmap;
   }
 
-#if 0
-  // Try to load it from the disk cache
-  std::unique_ptr<QIODevice> cache(icon_cache_->data(QUrl(cache_key)));
-  if (cache) {
-    QImage cached_image;
-    if (cached_image.load(cache.get(), "XPM")) {
-      QPixmapCache::insert(cache_key, QPixmap::fromImage(cached_image));
-      return QPixmap::fromImage(cached_image);
-    }
-  }
-#endif
-
-  // Maybe we're loading a pixmap already?
+  // Maybe we're loading a pixmap already?  The item is being painted, so load it before the ones that have been scrolled out of view.
   if (pending_cache_keys_.contains(cache_key)) {
+    app_->album_cover_loader()->PrioritizeTasks(QSet<quint64>() << pending_cache_keys_.value(cache_key));
     return no_cover_icon_;
   }
 
@@ -522,7 +527,7 @@ QVariant CollectionModel::AlbumIcon(const QModelIndex &index) {
   if (!songs.isEmpty()) {
     const quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, songs.first());
     pending_art_[id] = ItemAndCacheKey(item, cache_key);
-    pending_cache_keys_.insert(cache_key);
+    pending_cache_keys_.insert(cache_key, id);
   }
 
   return no_cover_icon_;
@@ -551,21 +556,6 @@ void CollectionModel::AlbumArtLoaded(quint64 id, const QImage &image) {
     QPixmapCache::insert(cache_key, image_pixmap);
   }
 
-#if 0
-  // if not already in the disk cache
-  std::unique_ptr<QIODevice> cached_img(icon_cache_->data(QUrl(cache_key)));
-  if (!cached_img && !image.isNull()) {
-    QNetworkCacheMetaData item_metadata;
-    item_metadata.setSaveToDisk(true);
-    item_metadata.setUrl(QUrl(cache_key));
-    QIODevice *cache = icon_cache_->prepare(item_metadata);
-    if (cache) {
-      image.save(cache, "XPM");
-      icon_cache_->insert(cache);
-    }
-  }
-#endif
-
   const QModelIndex index = ItemToIndex(item);
   emit dataChanged(index, index);
 
@@ -686,22 +676,21 @@ bool CollectionModel::HasCompilations(const CollectionQuery &query) {
 
 }
 
-CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
+CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent, int child_level, const QueryOptions &query_options, const Grouping &group_by) {
 
   QueryResult result;
 
   // Information about what we want the children to be
-  int child_level = parent == root_ ? 0 : parent->container_level + 1;
-  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by[child_level];
 
   // Initialise the query.  child_type says what type of thing we want (artists, songs, etc.)
-  CollectionQuery q(query_options_);
+  CollectionQuery q(query_options);
   InitQuery(child_type, &q);
 
   // Walk up through the item's parents adding filters as necessary
   CollectionItem *p = parent;
   while (p && p->type == CollectionItem::Type_Container) {
-    FilterQuery(group_by_[p->container_level], p, &q);
+    FilterQuery(group_by[p->container_level], p, &q);
     p = p->parent;
   }
 
@@ -728,26 +717,25 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
 
 }
 
-void CollectionModel::PostQuery(CollectionItem *parent, const CollectionModel::QueryResult &result, bool signal) {
+void CollectionModel::PostQuery(ItemTree *tree, CollectionItem *parent, int child_level, const Grouping &group_by, const CollectionModel::QueryResult &result, bool signal) {
 
   // Information about what we want the children to be
-  int child_level = parent == root_ ? 0 : parent->container_level + 1;
-  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by[child_level];
 
   if (result.create_va) {
-    CreateCompilationArtistNode(signal, parent);
+    CreateCompilationArtistNode(tree, signal, parent);
   }
 
   // Step through the results
   for (const SqlRow &row : result.rows) {
     // Create the item - it will get inserted into the model here
-    CollectionItem *item = ItemFromQuery(child_type, signal, child_level == 0, parent, row, child_level);
+    CollectionItem *item = ItemFromQuery(tree, child_type, signal, child_level == 0, parent, row, child_level);
 
     // Save a pointer to it for later
     if (child_type == GroupBy_None)
-      song_nodes_[item->metadata.id()] = item;
+      tree->song_nodes[item->metadata.id()] = item;
     else
-      container_nodes_[child_level][item->key] = item;
+      tree->container_nodes[child_level][item->key] = item;
   }
 
 }
@@ -756,25 +744,96 @@ void CollectionModel::LazyPopulate(CollectionItem *parent, bool signal) {
   if (parent->lazy_loaded) return;
   parent->lazy_loaded = true;
 
-  QueryResult result = RunQuery(parent);
-  PostQuery(parent, result, signal);
+  // Filter IDs are only looked up by ResetAsync, use the FTS table while they're out of date.
+  QueryOptions query_options = query_options_;
+  if (query_options.use_filter_ids() && (!search_index_ || filter_ids_generation_ != search_index_->generation())) {
+    query_options.clear_filter_ids();
+  }
+
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  QueryResult result = RunQuery(parent, child_level, query_options, group_by_);
+  PostQuery(&tree_, parent, child_level, group_by_, result, signal);
 
 }
 
 void CollectionModel::ResetAsync() {
-  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::RunQuery, root_);
-  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult>)), future);
+
+  // The worker gets its own copy of the options and grouping, they can be changed again before it's done.
+  // Only the tree from the latest reset is used, older ones are thrown away when they finish.
+  ++reset_generation_;
+  QueryOptions query_options = query_options_;
+
+  // The filter text is resolved to song IDs in the worker too, from a snapshot of the search index, unless the IDs from last time are still current.
+  CollectionSearchIndex::Snapshot search_index;
+  int search_index_generation = -1;
+  if (!query_options.filter().isEmpty() && search_index_ && search_index_->is_ready()) {
+    search_index_generation = search_index_->generation();
+    if (search_index_generation != filter_ids_generation_) search_index = search_index_->snapshot();
+  }
+  else {
+    query_options.clear_filter_ids();
+  }
+
+  QFuture<CollectionModel::Subtree> future = QtConcurrent::run(this, &CollectionModel::BuildSubtree, query_options, group_by_, search_index);
+  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::Subtree>, int, int)), future, reset_generation_, search_index_generation);
 
 }
 
-void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future) {
+CollectionModel::Subtree CollectionModel::BuildSubtree(QueryOptions query_options, const Grouping &group_by, const CollectionSearchIndex::Snapshot &search_index) {
 
-  const struct QueryResult result = future.result();
+  Subtree subtree;
 
-  BeginReset();
-  root_->lazy_loaded = true;
+  // The IDs are used however many songs match, short filters matching most of the collection are slow with the FTS table.
+  if (search_index) {
+    query_options.set_filter_ids(CollectionSearchIndex::Search(search_index, query_options.filter()));
+  }
+  subtree.filter_ids = query_options.filter_ids();
+
+  subtree.root = new CollectionItem(this);
+  subtree.root->compilation_artist_node_ = nullptr;
+  subtree.root->lazy_loaded = true;
+
+  const QueryResult result = RunQuery(subtree.root, 0, query_options, group_by);
+  PostQuery(&subtree.tree, subtree.root, 0, group_by, result, false);
+
+  // Put the children in sort order already, so the sort proxy has less work to do when the tree is spliced in.
+  QList<CollectionItem*> &children = subtree.root->children;
+  std::stable_sort(children.begin(), children.end(), &CollectionModel::CompareItems);
+  for (int i = 0 ; i < children.count() ; ++i) {
+    children[i]->row = i;
+  }
+
+  return subtree;
+
+}
+
+void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::Subtree> future, int generation, int search_index_generation) {
+
+  const Subtree subtree = future.result();
+
+  // The model was reset again since this was started.
+  if (generation != reset_generation_) {
+    delete subtree.root;
+    return;
+  }
+
+  // Keep the IDs for lazy loading the children, for as long as the index doesn't change.
+  if (search_index_generation != -1) {
+    query_options_.set_filter_ids(subtree.filter_ids);
+    filter_ids_generation_ = search_index_generation;
+  }
+
+  // Swap in the tree built by the worker, this is the only model signal needed.
+  beginResetModel();
+  delete root_;
+  pending_art_.clear();
 
-  PostQuery(root_, result, false);
+  root_ = subtree.root;
+  tree_.song_nodes = subtree.tree.song_nodes;
+  for (int i = 0 ; i < 3 ; ++i) {
+    tree_.container_nodes[i] = subtree.tree.container_nodes[i];
+  }
+  tree_.divider_nodes = subtree.tree.divider_nodes;
 
   if (init_task_id_ != -1) {
     app_->task_manager()->SetTaskFinished(init_task_id_);
@@ -787,13 +846,15 @@ void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResu
 
 void CollectionModel::BeginReset() {
 
+  ++reset_generation_;
+
   beginResetModel();
   delete root_;
-  song_nodes_.clear();
-  container_nodes_[0].clear();
-  container_nodes_[1].clear();
-  container_nodes_[2].clear();
-  divider_nodes_.clear();
+  tree_.song_nodes.clear();
+  tree_.container_nodes[0].clear();
+  tree_.container_nodes[1].clear();
+  tree_.container_nodes[2].clear();
+  tree_.divider_nodes.clear();
   pending_art_.clear();
 
   root_ = new CollectionItem(this);
@@ -965,7 +1026,7 @@ CollectionItem *CollectionModel::InitItem(GroupBy type, bool signal, CollectionI
 
 }
 
-CollectionItem *CollectionModel::ItemFromQuery(GroupBy type, bool signal, bool create_divider, CollectionItem *parent, const SqlRow &row, int container_level) {
+CollectionItem *CollectionModel::ItemFromQuery(ItemTree *tree, GroupBy type, bool signal, bool create_divider, CollectionItem *parent, const SqlRow &row, int container_level) {
 
   CollectionItem *item = InitItem(type, signal, parent, container_level);
   int year(0), effective_originalyear(0), disc(0), bitrate(0), samplerate(0), bitdepth(0);
@@ -1054,7 +1115,7 @@ CollectionItem *CollectionModel::ItemFromQuery(GroupBy type, bool signal, bool c
       break;
   }
 
-  FinishItem(type, signal, create_divider, parent, item);
+  FinishItem(tree, type, signal, create_divider, parent, item);
 
   return item;
 
@@ -1149,14 +1210,14 @@ CollectionItem *CollectionModel::ItemFromSong(GroupBy type, bool signal, bool cr
       break;
   }
 
-  FinishItem(type, signal, create_divider, parent, item);
+  FinishItem(&tree_, type, signal, create_divider, parent, item);
   if (s.url().scheme() == "cdda") item->lazy_loaded = true;
 
   return item;
 
 }
 
-void CollectionModel::FinishItem(GroupBy type, bool signal, bool create_divider, CollectionItem *parent, CollectionItem *item) {
+void CollectionModel::FinishItem(ItemTree *tree, GroupBy type, bool signal, bool create_divider, CollectionItem *parent, CollectionItem *item) {
 
   if (type == GroupBy_None) item->lazy_loaded = true;
 
@@ -1167,21 +1228,25 @@ void CollectionModel::FinishItem(GroupBy type, bool signal, bool create_divider,
     QString divider_key = DividerKey(type, item);
     item->sort_text.prepend(divider_key);
 
-    if (!divider_key.isEmpty() && !divider_nodes_.contains(divider_key)) {
+    if (!divider_key.isEmpty() && !tree->divider_nodes.contains(divider_key)) {
       if (signal)
         beginInsertRows(ItemToIndex(parent), parent->children.count(), parent->children.count());
 
-      CollectionItem *divider = new CollectionItem(CollectionItem::Type_Divider, root_);
+      // Dividers are only created for top level items, so the parent is the root.
+      CollectionItem *divider = new CollectionItem(CollectionItem::Type_Divider, parent);
       divider->key = divider_key;
       divider->display_text = DividerDisplayText(type, divider_key);
       divider->lazy_loaded = true;
+      divider->UpdateSortKey(tree->collator);
 
-      divider_nodes_[divider_key] = divider;
+      tree->divider_nodes[divider_key] = divider;
 
       if (signal) endInsertRows();
     }
   }
 
+  item->UpdateSortKey(tree->collator);
+
 }
 
 QString CollectionModel::TextOrUnknown(const QString &text) {
@@ -1298,14 +1363,8 @@ QMimeData *CollectionModel::mimeData(const QModelIndexList &indexes) const {
 
 }
 
-bool CollectionModel::CompareItems(const CollectionItem *a, const CollectionItem *b) const {
-
-  QVariant left(data(a, CollectionModel::Role_SortText));
-  QVariant right(data(b, CollectionModel::Role_SortText));
-
-  if (left.type() == QVariant::Int) return left.toInt() < right.toInt();
-  return left.toString() < right.toString();
-
+bool CollectionModel::CompareItems(const CollectionItem *a, const CollectionItem *b) {
+  return CollectionItem::SortKeyLessThan(a, b);
 }
 
 void CollectionModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls, SongList *songs, QSet<int> *song_ids) const {
@@ -1315,7 +1374,7 @@ void CollectionModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls, Son
       const_cast<CollectionModel*>(this)->LazyPopulate(item);
 
       QList<CollectionItem*> children = item->children;
-      std::sort(children.begin(), children.end(), std::bind(&CollectionModel::CompareItems, this, _1, _2));
+      std::sort(children.begin(), children.end(), &CollectionModel::CompareItems);
 
       for (CollectionItem *child : children)
         GetChildSongs(child, urls, songs, song_ids);
@@ -1353,13 +1412,40 @@ SongList CollectionModel::GetChildSongs(const QModelIndex &index) const {
   return GetChildSongs(QModelIndexList() << index);
 }
 
+SmartPlaylistSearchTermList CollectionModel::SmartPlaylistTerms(const QModelIndex &index) const {
+
+  // One rule for each container from the top level down to the item.
+  SmartPlaylistSearchTermList terms;
+  for (const CollectionItem *item = IndexToItem(index) ; item && item != root_ ; item = item->parent) {
+    if (item->type != CollectionItem::Type_Container || IsCompilationArtistNode(item)) return SmartPlaylistSearchTermList();
+
+    SmartPlaylistSearchTerm::Field field;
+    switch (group_by_[item->container_level]) {
+      case GroupBy_Artist:      field = SmartPlaylistSearchTerm::Field_Artist; break;
+      case GroupBy_AlbumArtist: field = SmartPlaylistSearchTerm::Field_AlbumArtist; break;
+      case GroupBy_Album:       field = SmartPlaylistSearchTerm::Field_Album; break;
+      case GroupBy_Genre:       field = SmartPlaylistSearchTerm::Field_Genre; break;
+      case GroupBy_Year:        field = SmartPlaylistSearchTerm::Field_Year; break;
+      default:                  return SmartPlaylistSearchTermList();
+    }
+
+    const QVariant value = SmartPlaylistSearchTerm::IsTextField(field) ? QVariant(item->key) : QVariant(item->key.toInt());
+    terms.prepend(SmartPlaylistSearchTerm(field, SmartPlaylistSearchTerm::Op_Equals, value));
+  }
+
+  return terms;
+
+}
+
 void CollectionModel::SetFilterAge(int age) {
   query_options_.set_max_age(age);
   ResetAsync();
 }
 
 void CollectionModel::SetFilterText(const QString &text) {
+
   query_options_.set_filter(text);
+  filter_ids_generation_ = -1;
   ResetAsync();
 
 }
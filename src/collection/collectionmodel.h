@@ -28,6 +28,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QAbstractItemModel>
+#include <QCollator>
 #include <QFuture>
 #include <QDataStream>
 #include <QList>
@@ -37,21 +38,23 @@
 #include <QPair>
 #include <QSet>
 #include <QVariant>
+#include <QVector>
 #include <QString>
 #include <QStringList>
 #include <QUrl>
 #include <QImage>
 #include <QIcon>
 #include <QPixmap>
-#include <QNetworkDiskCache>
 #include <QSettings>
 
 #include "core/simpletreemodel.h"
 #include "core/song.h"
 #include "collectionquery.h"
+#include "collectionsearchindex.h"
 #include "collectionitem.h"
 #include "sqlrow.h"
 #include "covermanager/albumcoverloaderoptions.h"
+#include "playlist/smartplaylistsearch.h"
 
 class Application;
 class CollectionBackend;
@@ -69,7 +72,6 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   static const char *kSavedGroupingsSettingsGroup;
 
   static const int kPrettyCoverSize;
-  static const qint64 kIconCacheSize;
 
   enum Role {
     Role_Type = Qt::UserRole + 1,
@@ -126,6 +128,31 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
     bool create_va;
   };
 
+  // Lookup tables and collator used when adding items to a tree.
+  // The model keeps one for its own tree, ResetAsync fills a separate one for the detached tree it builds in a worker thread.
+  struct ItemTree {
+    // Keyed on database ID
+    QMap<int, CollectionItem*> song_nodes;
+
+    // Keyed on whatever the key is for that level - artist, album, year, etc.
+    QMap<QString, CollectionItem*> container_nodes[3];
+
+    // Keyed on a letter, a year, a century, etc.
+    QMap<QString, CollectionItem*> divider_nodes;
+
+    QCollator collator;
+  };
+
+  // A complete top level built by ResetAsync, not yet part of the model.
+  struct Subtree {
+    Subtree() : root(nullptr) {}
+
+    CollectionItem *root;
+    ItemTree tree;
+    // Song IDs the filter text was resolved to, if the search index was used.
+    QVector<int> filter_ids;
+  };
+
   CollectionBackend *backend() const { return backend_; }
   CollectionDirectoryModel *directory_model() const { return dir_model_; }
 
@@ -137,6 +164,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   SongList GetChildSongs(const QModelIndex &index) const;
   SongList GetChildSongs(const QModelIndexList &indexes) const;
 
+  // Returns the smart playlist rules matching the songs below a container, or an empty list if its grouping can't be expressed as rules.
+  SmartPlaylistSearchTermList SmartPlaylistTerms(const QModelIndex &index) const;
+
   // Might be accurate
   int total_song_count() const { return total_song_count_; }
   int total_artist_count() const { return total_artist_count_; }
@@ -156,6 +186,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   // Whether or not to show letters heading in the collection view
   void set_show_dividers(bool show_dividers);
 
+  // Whether or not to resolve the filter text with an in-memory index instead of the FTS table
+  void set_use_search_index(bool use_search_index);
+
   // Save the current grouping
   void SaveGrouping(QString name);
 
@@ -169,6 +202,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   static QString SortTextForYear(int year);
   static QString SortTextForBitrate(int bitrate);
 
+  // Sorts items on their precomputed collation keys, used by CollectionSortModel.
+  static bool CompareItems(const CollectionItem *a, const CollectionItem *b);
+
 signals:
   void TotalSongCountUpdated(int count);
   void TotalArtistCountUpdated(int count);
@@ -200,15 +236,20 @@ signals:
   void TotalAlbumCountUpdatedSlot(int count);
 
   // Called after ResetAsync
-  void ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future);
+  void ResetAsyncQueryFinished(QFuture<CollectionModel::Subtree> future, int generation, int search_index_generation);
 
   void AlbumArtLoaded(quint64 id, const QImage &image);
 
  private:
   // Provides some optimisations for loading the list of items in the root.
   // This gets called a lot when filtering the playlist, so it's nice to be able to do it in a background thread.
-  QueryResult RunQuery(CollectionItem *parent);
-  void PostQuery(CollectionItem *parent, const QueryResult &result, bool signal);
+  // child_level is the container level of the items to create, 0 for the top level.
+  QueryResult RunQuery(CollectionItem *parent, int child_level, const QueryOptions &query_options, const Grouping &group_by);
+  void PostQuery(ItemTree *tree, CollectionItem *parent, int child_level, const Grouping &group_by, const QueryResult &result, bool signal);
+
+  // Runs the query for the top level and creates the items, dividers and their sort keys outside the model, so it can be done in a worker thread.
+  // Doesn't touch root_, tree_, query_options_ or group_by_, they belong to the GUI thread.
+  Subtree BuildSubtree(QueryOptions query_options, const Grouping &group_by, const CollectionSearchIndex::Snapshot &search_index);
 
   bool HasCompilations(const CollectionQuery &query);
 
@@ -221,15 +262,15 @@ signals:
   void FilterQuery(GroupBy type, CollectionItem *item, CollectionQuery *q);
 
   // Items can be created either from a query that's been run to populate a node, or by a spontaneous SongsDiscovered emission from the backend.
-  CollectionItem *ItemFromQuery(GroupBy type, bool signal, bool create_divider, CollectionItem *parent, const SqlRow &row, int container_level);
+  CollectionItem *ItemFromQuery(ItemTree *tree, GroupBy type, bool signal, bool create_divider, CollectionItem *parent, const SqlRow &row, int container_level);
   CollectionItem *ItemFromSong(GroupBy type, bool signal, bool create_divider, CollectionItem *parent, const Song &s, int container_level);
 
   // The "Various Artists" node is an annoying special case.
-  CollectionItem *CreateCompilationArtistNode(bool signal, CollectionItem *parent);
+  CollectionItem *CreateCompilationArtistNode(ItemTree *tree, bool signal, CollectionItem *parent);
 
   // Helpers for ItemFromQuery and ItemFromSong
   CollectionItem *InitItem(GroupBy type, bool signal, CollectionItem *parent, int container_level);
-  void FinishItem(GroupBy type, bool signal, bool create_divider, CollectionItem *parent, CollectionItem *item);
+  void FinishItem(ItemTree *tree, GroupBy type, bool signal, bool create_divider, CollectionItem *parent, CollectionItem *item);
 
   QString DividerKey(GroupBy type, CollectionItem *item) const;
   QString DividerDisplayText(GroupBy type, const QString &key) const;
@@ -238,7 +279,6 @@ signals:
   QString AlbumIconPixmapCacheKey(const QModelIndex &index) const;
   QVariant AlbumIcon(const QModelIndex &index);
   QVariant data(const CollectionItem *item, int role) const;
-  bool CompareItems(const CollectionItem *a, const CollectionItem *b) const;
 
  private:
   CollectionBackend *backend_;
@@ -253,14 +293,7 @@ signals:
   QueryOptions query_options_;
   Grouping group_by_;
 
-  // Keyed on database ID
-  QMap<int, CollectionItem*> song_nodes_;
-
-  // Keyed on whatever the key is for that level - artist, album, year, etc.
-  QMap<QString, CollectionItem*> container_nodes_[3];
-
-  // Keyed on a letter, a year, a century, etc.
-  QMap<QString, CollectionItem*> divider_nodes_;
+  ItemTree tree_;
 
   QIcon artist_icon_;
   QIcon album_icon_;
@@ -269,7 +302,11 @@ signals:
   QIcon playlists_dir_icon_;
   QIcon playlist_icon_;
 
-  QNetworkDiskCache *icon_cache_;
+  CollectionSearchIndex *search_index_;
+  // The index generation the filter IDs in query_options_ were looked up at, -1 if they have to be looked up again.
+  int filter_ids_generation_;
+  // Incremented on every reset, so a tree built by ResetAsync can tell if it's still wanted.
+  int reset_generation_;
 
   int init_task_id_;
 
@@ -280,7 +317,7 @@ signals:
 
   typedef QPair<CollectionItem*, QString> ItemAndCacheKey;
   QMap<quint64, ItemAndCacheKey> pending_art_;
-  QSet<QString> pending_cache_keys_;
+  QMap<QString, quint64> pending_cache_keys_;
 };
 
 Q_DECLARE_METATYPE(CollectionModel::Grouping);
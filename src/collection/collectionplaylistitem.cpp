@@ -44,7 +44,7 @@ void CollectionPlaylistItem::Reload() {
 }
 
 bool CollectionPlaylistItem::InitFromQuery(const SqlRow &query) {
-  // Rows from the songs tables come first
+  // Expects a row from the songs table
   song_.InitFromQuery(query, true);
   return song_.is_valid();
 }
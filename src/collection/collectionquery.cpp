@@ -34,12 +34,22 @@
 #include "core/logging.h"
 #include "core/song.h"
 
-QueryOptions::QueryOptions() : max_age_(-1), query_mode_(QueryMode_All) {}
+QueryOptions::QueryOptions() : use_filter_ids_(false), max_age_(-1), query_mode_(QueryMode_All) {}
 
 CollectionQuery::CollectionQuery(const QueryOptions &options)
     : include_unavailable_(false), join_with_fts_(false), limit_(-1) {
 
-  if (!options.filter().isEmpty()) {
+  if (!options.filter().isEmpty() && options.use_filter_ids()) {
+    // The filter was already resolved to song IDs in memory, so skip the FTS join.
+    // Integers are done inline, see AddWhere.
+    QStringList ids;
+    ids.reserve(options.filter_ids().count());
+    for (int id : options.filter_ids()) {
+      ids << QString::number(id);
+    }
+    where_clauses_ << "%songs_table.ROWID IN (" + ids.join(",") + ")";
+  }
+  else if (!options.filter().isEmpty()) {
     // We need to munge the filter text a little bit to get it to work as expected with sqlite's FTS3:
     //  1) Append * to all tokens.
     //  2) Prefix "fts" to column names.
@@ -135,6 +145,18 @@ void CollectionQuery::AddWhere(const QString &column, const QVariant &value, con
 
 }
 
+void CollectionQuery::AddWhereContains(const QString &column, const QString &value) {
+
+  QString pattern = value;
+  pattern.replace('\\', "\\\\");
+  pattern.replace('%', "\\%");
+  pattern.replace('_', "\\_");
+
+  where_clauses_ << QString("%1 LIKE ? ESCAPE '\\'").arg(column);
+  bound_values_ << "%" + pattern + "%";
+
+}
+
 void CollectionQuery::AddCompilationRequirement(bool compilation) {
   // The unary + is added to prevent sqlite from using the index idx_comp_artist.
   // When joining with fts, sqlite 3.8 has a tendency to use this index and thereby nesting the tables in an order which gives very poor performance
@@ -27,6 +27,7 @@
 
 #include <QMetaType>
 #include <QVariant>
+#include <QVector>
 #include <QString>
 #include <QStringList>
 #include <QSqlDatabase>
@@ -56,6 +57,20 @@ struct QueryOptions {
   void set_filter(const QString &filter) {
     this->filter_ = filter;
     this->query_mode_ = QueryMode_All;
+    this->use_filter_ids_ = false;
+    this->filter_ids_.clear();
+  }
+
+  // Song IDs matching the filter, resolved by CollectionSearchIndex.  When set these are used instead of the FTS table.
+  bool use_filter_ids() const { return use_filter_ids_; }
+  const QVector<int> &filter_ids() const { return filter_ids_; }
+  void set_filter_ids(const QVector<int> &filter_ids) {
+    this->filter_ids_ = filter_ids;
+    this->use_filter_ids_ = true;
+  }
+  void clear_filter_ids() {
+    this->use_filter_ids_ = false;
+    this->filter_ids_.clear();
   }
 
   int max_age() const { return max_age_; }
@@ -69,6 +84,8 @@ struct QueryOptions {
 
  private:
   QString filter_;
+  bool use_filter_ids_;
+  QVector<int> filter_ids_;
   int max_age_;
   QueryMode query_mode_;
 };
@@ -85,6 +102,9 @@ class CollectionQuery {
   // Adds a fragment of WHERE clause. When executed, this Query will connect all the fragments with AND operator.
   // Please note that IN operator expects a QStringList as value.
   void AddWhere(const QString &column, const QVariant &value, const QString &op = "=");
+  // Adds a LIKE fragment matching value anywhere in the column.  % and _ in the value are escaped, so they're matched literally.
+  // Like all of sqlite's LIKE, only ASCII letters are compared case-insensitively.
+  void AddWhereContains(const QString &column, const QString &value);
 
   void AddCompilationRequirement(bool compilation);
   void SetLimit(int limit) { limit_ = limit; }
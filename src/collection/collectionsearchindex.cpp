@@ -0,0 +1,343 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QObject>
+#include <QtGlobal>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
+#include <QFuture>
+#include <QMutex>
+#include <QBitArray>
+#include <QChar>
+#include <QRegExp>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "core/closure.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "collectionbackend.h"
+#include "collectionquery.h"
+#include "collectionsearchindex.h"
+
+const double CollectionSearchIndex::kCompactThreshold = 0.5;
+
+CollectionSearchIndex::CollectionSearchIndex(CollectionBackend *backend, QObject *parent)
+    : QObject(parent),
+      backend_(backend),
+      loading_(false),
+      generation_(0) {
+
+  connect(backend_, SIGNAL(SongsDiscovered(SongList)), SLOT(SongsDiscovered(SongList)));
+  connect(backend_, SIGNAL(SongsDeleted(SongList)), SLOT(SongsDeleted(SongList)));
+  connect(backend_, SIGNAL(DatabaseReset()), SLOT(LoadAsync()));
+
+}
+
+CollectionSearchIndex::~CollectionSearchIndex() {}
+
+void CollectionSearchIndex::LoadAsync() {
+
+  if (loading_) return;
+  loading_ = true;
+  pending_changes_.clear();
+
+  // The worker gets its own reference to the data, the index might be deleted before it's done.
+  loading_data_ = std::make_shared<Data>();
+  QFuture<void> future = QtConcurrent::run(&CollectionSearchIndex::LoadBlocking, backend_, loading_data_);
+  NewClosure(future, this, SLOT(LoadFinished(QFuture<void>)), future);
+
+}
+
+void CollectionSearchIndex::LoadBlocking(CollectionBackend *backend, std::shared_ptr<Data> data) {
+
+  QElapsedTimer timer;
+  timer.start();
+
+  CollectionQuery q;
+  q.SetColumnSpec("%songs_table.ROWID, title, album, artist, albumartist, composer, performer, grouping, genre, comment");
+
+  QMutexLocker l(backend->db()->Mutex());
+  if (!backend->ExecQuery(&q)) return;
+
+  QString values[ColumnCount];
+  while (q.Next()) {
+    for (int i = 0 ; i < ColumnCount ; ++i) {
+      values[i] = q.Value(i + 1).toString();
+    }
+    AddRow(data.get(), q.Value(0).toInt(), values);
+  }
+
+  qLog(Debug) << "Collection search index loaded" << data->live_count << "songs in" << timer.elapsed() << "ms";
+
+}
+
+void CollectionSearchIndex::LoadFinished(QFuture<void>) {
+
+  data_ = loading_data_;
+  loading_data_.reset();
+  loading_ = false;
+  ++generation_;
+
+  // Catch up with anything the backend changed while we were loading.
+  for (const PendingChange &change : pending_changes_) {
+    if (change.first) ApplyDeleted(MutableData(), change.second);
+    else ApplyDiscovered(MutableData(), change.second);
+  }
+  pending_changes_.clear();
+
+  emit Ready();
+
+}
+
+void CollectionSearchIndex::SongsDiscovered(const SongList &songs) {
+
+  if (loading_) pending_changes_ << PendingChange(false, songs);
+  if (data_) ApplyDiscovered(MutableData(), songs);
+  ++generation_;
+
+}
+
+void CollectionSearchIndex::SongsDeleted(const SongList &songs) {
+
+  if (loading_) pending_changes_ << PendingChange(true, songs);
+  if (!data_) return;
+  ++generation_;
+
+  ApplyDeleted(MutableData(), songs);
+
+  // Deleted rows are only masked out, rebuild the arrays from the database once most of them are dead.
+  const int dead_count = data_->ids.count() - data_->live_count;
+  if (!loading_ && dead_count > 0 && dead_count > data_->ids.count() * kCompactThreshold) {
+    LoadAsync();
+  }
+
+}
+
+CollectionSearchIndex::Data *CollectionSearchIndex::MutableData() {
+
+  // The containers in Data are implicitly shared, so the copy is cheap until they're written to.
+  if (data_.use_count() > 1) data_ = std::make_shared<Data>(*data_);
+  return data_.get();
+
+}
+
+void CollectionSearchIndex::ApplyDiscovered(Data *data, const SongList &songs) {
+
+  QString values[ColumnCount];
+  for (const Song &song : songs) {
+    if (song.id() == -1) continue;
+    values[Column_Title] = song.title();
+    values[Column_Album] = song.album();
+    values[Column_Artist] = song.artist();
+    values[Column_AlbumArtist] = song.albumartist();
+    values[Column_Composer] = song.composer();
+    values[Column_Performer] = song.performer();
+    values[Column_Grouping] = song.grouping();
+    values[Column_Genre] = song.genre();
+    values[Column_Comment] = song.comment();
+    AddRow(data, song.id(), values);
+  }
+
+}
+
+void CollectionSearchIndex::ApplyDeleted(Data *data, const SongList &songs) {
+
+  for (const Song &song : songs) {
+    RemoveRow(data, song.id());
+  }
+
+}
+
+void CollectionSearchIndex::AddRow(Data *data, int id, const QString (&values)[ColumnCount]) {
+
+  // An updated song keeps its row, so updates don't leave dead rows behind.
+  QHash<int, int>::const_iterator it = data->row_by_id.constFind(id);
+  if (it != data->row_by_id.constEnd()) {
+    ReplaceRow(data, it.value(), values);
+    return;
+  }
+
+  const int row = data->ids.count();
+  data->ids << id;
+  if (row >= data->live.size()) data->live.resize(qMax(1024, row * 2));
+  data->live.setBit(row);
+  data->row_by_id.insert(id, row);
+  ++data->live_count;
+
+  for (int i = 0 ; i < ColumnCount ; ++i) {
+    data->columns[i] << values[i];
+    for (const QString &word : Tokenize(values[i])) {
+      QVector<int> &rows = data->words[i][word];
+      if (rows.isEmpty() || rows.last() != row) rows << row;
+    }
+  }
+
+}
+
+void CollectionSearchIndex::ReplaceRow(Data *data, int row, const QString (&values)[ColumnCount]) {
+
+  for (int i = 0 ; i < ColumnCount ; ++i) {
+    QString &value = data->columns[i][row];
+    if (value == values[i]) continue;
+
+    QMap<QString, QVector<int>> &words = data->words[i];
+    for (const QString &word : Tokenize(value)) {
+      QMap<QString, QVector<int>>::iterator word_it = words.find(word);
+      if (word_it == words.end()) continue;
+      word_it->removeAll(row);
+      if (word_it->isEmpty()) words.erase(word_it);
+    }
+
+    value = values[i];
+    for (const QString &word : Tokenize(value)) {
+      QVector<int> &rows = words[word];
+      if (!rows.contains(row)) rows << row;
+    }
+  }
+
+}
+
+void CollectionSearchIndex::RemoveRow(Data *data, int id) {
+
+  QHash<int, int>::iterator it = data->row_by_id.find(id);
+  if (it == data->row_by_id.end()) return;
+
+  data->live.clearBit(it.value());
+  data->row_by_id.erase(it);
+  --data->live_count;
+
+}
+
+QStringList CollectionSearchIndex::Tokenize(const QString &text) {
+
+  // Must split and normalise the same way as the unicode FTS tokenizer in Database.
+
+  QStringList ret;
+  QString token;
+  const QString str = text.toLower();
+  for (const QChar &c : str) {
+    if (!c.isLetterOrNumber()) {
+      if (!token.isEmpty()) {
+        ret << token;
+        token.clear();
+      }
+    }
+    else if (c.decompositionTag() != QChar::NoDecomposition) {
+      token.append(c.decomposition()[0]);
+    }
+    else {
+      token.append(c);
+    }
+  }
+  if (!token.isEmpty()) ret << token;
+
+  return ret;
+
+}
+
+void CollectionSearchIndex::RunLookup(Lookup &lookup) {
+
+  const Data *data = lookup.data;
+  lookup.result = QBitArray(data->ids.count());
+
+  const QMap<QString, QVector<int>> &words = data->words[lookup.column];
+  QMap<QString, QVector<int>>::const_iterator it = words.lowerBound(lookup.word);
+  for (; it != words.constEnd() ; ++it) {
+    if (lookup.prefix ? !it.key().startsWith(lookup.word) : it.key() != lookup.word) break;
+    for (int row : it.value()) {
+      lookup.result.setBit(row);
+    }
+  }
+
+}
+
+QVector<int> CollectionSearchIndex::Search(const Snapshot &data, const QString &filter) {
+
+  if (!data) return QVector<int>();
+
+  // Parse the filter the same way CollectionQuery builds the FTS MATCH expression:
+  // every whitespace separated token has to match, "column:value" restricts the token to one column, and the last word of each token is a prefix.
+  // Each term is a list of lookups that are OR'ed together, the terms are AND'ed.
+  QList<QList<int>> terms;
+  QVector<Lookup> lookups;
+
+  QStringList tokens(filter.split(QRegExp("\\s+"), QString::SkipEmptyParts));
+  for (QString token : tokens) {
+    token.remove('(');
+    token.remove(')');
+    token.remove('"');
+
+    int column = -1;
+    if (token.contains(':')) {
+      const QString column_name = "fts" + token.section(':', 0, 0);
+      for (int i = 0 ; i < Song::kFtsColumns.count() ; ++i) {
+        if (Song::kFtsColumns[i].compare(column_name, Qt::CaseInsensitive) == 0) {
+          column = i;
+          token = token.section(':', 1, -1);
+          break;
+        }
+      }
+    }
+
+    const QStringList words = Tokenize(token);
+    for (int w = 0 ; w < words.count() ; ++w) {
+      QList<int> term;
+      for (int i = 0 ; i < ColumnCount ; ++i) {
+        // Like in the FTS query, "column:" only applies to the first word of the token.
+        if (column != -1 && w == 0 && column != i) continue;
+        Lookup lookup;
+        lookup.data = data.get();
+        lookup.column = i;
+        lookup.word = words[w];
+        lookup.prefix = (w == words.count() - 1);
+        term << lookups.count();
+        lookups << lookup;
+      }
+      terms << term;
+    }
+  }
+
+  if (terms.isEmpty()) return QVector<int>();
+
+  QtConcurrent::blockingMap(lookups, &CollectionSearchIndex::RunLookup);
+
+  QBitArray matches = data->live;
+  for (const QList<int> &term : terms) {
+    QBitArray term_matches(data->ids.count());
+    for (int i : term) {
+      term_matches |= lookups[i].result;
+    }
+    matches &= term_matches;
+  }
+
+  QVector<int> ret;
+  for (int row = 0 ; row < data->ids.count() ; ++row) {
+    if (matches.testBit(row)) ret << data->ids[row];
+  }
+  std::sort(ret.begin(), ret.end());
+
+  return ret;
+
+}
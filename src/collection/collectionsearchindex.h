@@ -0,0 +1,151 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COLLECTIONSEARCHINDEX_H
+#define COLLECTIONSEARCHINDEX_H
+
+#include "config.h"
+
+#include <memory>
+
+#include <QObject>
+#include <QFuture>
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "core/song.h"
+
+class CollectionBackend;
+
+// In-memory copy of the columns in the FTS table, used to resolve the collection filter text to a list of song IDs without going through sqlite.
+// Each searchable column is kept as a compact array indexed by row, together with a sorted word -> rows map used for prefix lookups.
+// The index is loaded once from the database in a background thread and then kept up to date from the backend's SongsDiscovered and SongsDeleted signals.
+// Updated songs replace their row in place, deleted songs are masked out until the index is compacted.
+class CollectionSearchIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  CollectionSearchIndex(CollectionBackend *backend, QObject *parent = nullptr);
+  ~CollectionSearchIndex();
+
+  // Same columns and order as Song::kFtsColumns.
+  enum Column {
+    Column_Title = 0,
+    Column_Album,
+    Column_Artist,
+    Column_AlbumArtist,
+    Column_Composer,
+    Column_Performer,
+    Column_Grouping,
+    Column_Genre,
+    Column_Comment,
+    ColumnCount
+  };
+
+  // A read-only view of the index as it was when it was taken.  The index copies its data before changing it while a snapshot is held,
+  // so snapshots can be searched from other threads.
+  struct Data;
+  typedef std::shared_ptr<const Data> Snapshot;
+
+  bool is_ready() const { return data_ != nullptr; }
+  int song_count() const { return data_ ? data_->live_count : 0; }
+  // Changes whenever the indexed songs change, so results of Search() can be cached until then.
+  int generation() const { return generation_; }
+
+  Snapshot snapshot() const { return data_; }
+
+  // Returns the sorted IDs of all songs matching the filter text, using the same rules as the FTS query built by CollectionQuery.
+  // The lookups for each token and column are run in parallel, so this is meant to be called from a worker thread.
+  static QVector<int> Search(const Snapshot &data, const QString &filter);
+
+  static QStringList Tokenize(const QString &text);
+
+ signals:
+  void Ready();
+
+ public slots:
+  // Loads all available songs from the database in a background thread.  Emits Ready() when done.
+  void LoadAsync();
+
+  void SongsDiscovered(const SongList &songs);
+  void SongsDeleted(const SongList &songs);
+
+ private slots:
+  void LoadFinished(QFuture<void> future);
+
+ public:
+  struct Data {
+    Data() : live_count(0) {}
+
+    QVector<int> ids;
+    QVector<QString> columns[ColumnCount];
+    QMap<QString, QVector<int>> words[ColumnCount];
+    QBitArray live;
+    QHash<int, int> row_by_id;
+    int live_count;
+  };
+
+ private:
+  struct Lookup {
+    Lookup() : data(nullptr), column(-1), prefix(false) {}
+
+    const Data *data;
+    int column;
+    QString word;
+    bool prefix;
+    QBitArray result;
+  };
+
+  // First is true for deleted songs.
+  typedef QPair<bool, SongList> PendingChange;
+
+  // Only uses its arguments, so the index can be deleted while this is still running.
+  static void LoadBlocking(CollectionBackend *backend, std::shared_ptr<Data> data);
+
+  // Returns data_ for changing it, copying it first if a snapshot of it is still in use.
+  Data *MutableData();
+
+  static void ApplyDiscovered(Data *data, const SongList &songs);
+  static void ApplyDeleted(Data *data, const SongList &songs);
+  static void AddRow(Data *data, int id, const QString (&values)[ColumnCount]);
+  static void ReplaceRow(Data *data, int row, const QString (&values)[ColumnCount]);
+  static void RemoveRow(Data *data, int id);
+  static void RunLookup(Lookup &lookup);
+
+ private:
+  // If more than this fraction of the rows are deleted, the index is reloaded.
+  static const double kCompactThreshold;
+
+  CollectionBackend *backend_;
+  std::shared_ptr<Data> data_;
+  std::shared_ptr<Data> loading_data_;
+  bool loading_;
+  int generation_;
+
+  // Changes from the backend received while loading, applied in order when the load has finished.
+  QList<PendingChange> pending_changes_;
+};
+
+#endif  // COLLECTIONSEARCHINDEX_H
@@ -0,0 +1,47 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QObject>
+#include <QSortFilterProxyModel>
+#include <QModelIndex>
+
+#include "collectionitem.h"
+#include "collectionmodel.h"
+#include "collectionsortmodel.h"
+
+CollectionSortModel::CollectionSortModel(QObject *parent)
+    : QSortFilterProxyModel(parent) {
+
+  setSortRole(CollectionModel::Role_SortText);
+  setDynamicSortFilter(true);
+
+}
+
+bool CollectionSortModel::lessThan(const QModelIndex &left, const QModelIndex &right) const {
+
+  // The source is always a CollectionModel, so the internal pointers are the items.
+  const CollectionItem *item_left = reinterpret_cast<const CollectionItem*>(left.internalPointer());
+  const CollectionItem *item_right = reinterpret_cast<const CollectionItem*>(right.internalPointer());
+  if (!item_left || !item_right) return QSortFilterProxyModel::lessThan(left, right);
+
+  return CollectionModel::CompareItems(item_left, item_right);
+
+}
@@ -0,0 +1,38 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COLLECTIONSORTMODEL_H
+#define COLLECTIONSORTMODEL_H
+
+#include "config.h"
+
+#include <QObject>
+#include <QSortFilterProxyModel>
+#include <QModelIndex>
+
+// Sorts a CollectionModel on the collation keys stored in the items instead of comparing the sort text of every pair.
+class CollectionSortModel : public QSortFilterProxyModel {
+ public:
+  CollectionSortModel(QObject *parent = nullptr);
+
+ protected:
+  bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
+};
+
+#endif  // COLLECTIONSORTMODEL_H
@@ -76,6 +76,8 @@
 #ifdef HAVE_GSTREAMER
 #include "dialogs/organisedialog.h"
 #endif
+#include "playlist/playlistmanager.h"
+#include "playlist/smartplaylistsearch.h"
 #include "settings/collectionsettingspage.h"
 
 CollectionItemDelegate::CollectionItemDelegate(QObject *parent) : QStyledItemDelegate(parent) {}
@@ -345,6 +347,7 @@ void CollectionView::ReloadSettings() {
   if (app_) {
     app_->collection_model()->set_pretty_covers(settings.value("pretty_covers", true).toBool());
     app_->collection_model()->set_show_dividers(settings.value("show_dividers", true).toBool());
+    app_->collection_model()->set_use_search_index(settings.value("search_index", false).toBool());
   }
 
   settings.endGroup();
@@ -455,6 +458,7 @@ void CollectionView::contextMenuEvent(QContextMenuEvent *e) {
     add_to_playlist_ = context_menu_->addAction(IconLoader::Load("media-play"), tr("Append to current playlist"), this, SLOT(AddToPlaylist()));
     load_ = context_menu_->addAction(IconLoader::Load("media-play"), tr("Replace current playlist"), this, SLOT(Load()));
     open_in_new_playlist_ = context_menu_->addAction(IconLoader::Load("document-new"), tr("Open in new playlist"), this, SLOT(OpenInNewPlaylist()));
+    create_smart_playlist_ = context_menu_->addAction(IconLoader::Load("document-new"), tr("Create smart playlist"), this, SLOT(CreateSmartPlaylist()));
 
     context_menu_->addSeparator();
     add_to_playlist_enqueue_ = context_menu_->addAction(IconLoader::Load("go-next"), tr("Queue track"), this, SLOT(AddToPlaylistEnqueue()));
@@ -515,6 +519,9 @@ void CollectionView::contextMenuEvent(QContextMenuEvent *e) {
   open_in_new_playlist_->setEnabled(songs_selected);
   add_to_playlist_enqueue_->setEnabled(songs_selected);
 
+  // Only for containers whose grouping can be turned into smart playlist rules
+  create_smart_playlist_->setVisible(!app_->collection_model()->SmartPlaylistTerms(context_menu_index_).isEmpty());
+
   // if neither edit_track not edit_tracks are available, we show disabled edit_track element
   edit_track_->setVisible(regular_editable <= 1);
   edit_track_->setEnabled(regular_editable == 1);
@@ -626,6 +633,16 @@ void CollectionView::OpenInNewPlaylist() {
 
 }
 
+void CollectionView::CreateSmartPlaylist() {
+
+  if (!context_menu_index_.isValid()) return;
+
+  // The playlist is kept up to date with the collection, unlike one opened from the selection.
+  const SmartPlaylistSearch search(app_->collection_model()->SmartPlaylistTerms(context_menu_index_));
+  app_->playlist_manager()->NewSmartPlaylist(context_menu_index_.data().toString(), search);
+
+}
+
 void CollectionView::keyboardSearch(const QString &search) {
 
   is_in_keyboard_search_ = true;
@@ -118,6 +118,7 @@ signals:
   void AddToPlaylist();
   void AddToPlaylistEnqueue();
   void OpenInNewPlaylist();
+  void CreateSmartPlaylist();
 #ifdef HAVE_GSTREAMER
   void Organise();
   void CopyToDevice();
@@ -149,6 +150,7 @@ signals:
   QAction *add_to_playlist_;
   QAction *add_to_playlist_enqueue_;
   QAction *open_in_new_playlist_;
+  QAction *create_smart_playlist_;
 #ifdef HAVE_GSTREAMER
   QAction *organise_;
 #ifndef Q_OS_WIN
@@ -428,9 +428,6 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
 
 void CollectionWatcher::UpdateCueAssociatedSongs(const QString &file, const QString &path, const QString &matching_cue, const QString &image, ScanTransaction *t) {
 
-  QFile cue(matching_cue);
-  cue.open(QIODevice::ReadOnly);
-
   SongList old_sections = backend_->GetSongsByUrl(QUrl::fromLocalFile(file));
 
   QHash<quint64, Song> sections_map;
@@ -441,7 +438,7 @@ void CollectionWatcher::UpdateCueAssociatedSongs(const QString &file, const QStr
   QSet<int> used_ids;
 
   // Update every song that's in the cue and collection
-  for (Song cue_song : cue_parser_->Load(&cue, matching_cue, path)) {
+  for (Song cue_song : cue_parser_->LoadFile(matching_cue, path)) {
     cue_song.set_source(Song::Source_Collection);
     cue_song.set_directory_id(t->dir());
 
@@ -498,14 +495,11 @@ SongList CollectionWatcher::ScanNewFile(const QString &file, const QString &path
     // don't process the same cue many times
     if (cues_processed->contains(matching_cue)) return song_list;
 
-    QFile cue(matching_cue);
-    cue.open(QIODevice::ReadOnly);
-
     // Ignore FILEs pointing to other media files.
     // Also, watch out for incorrect media files.
     // Playlist parser for CUEs considers every entry in sheet valid and we don't want invalid media getting into collection!
     QString file_nfd = file.normalized(QString::NormalizationForm_D);
-    for (const Song &cue_song : cue_parser_->Load(&cue, matching_cue, path)) {
+    for (const Song &cue_song : cue_parser_->LoadFile(matching_cue, path)) {
       if (cue_song.url().toLocalFile().normalized(QString::NormalizationForm_D) == file_nfd) {
         if (TagReaderClient::Instance()->IsMediaFileBlocking(file)) {
           song_list << cue_song;
@@ -56,10 +56,7 @@
 
 #include "contextalbumsmodel.h"
 
-using std::bind;
 using std::sort;
-using std::placeholders::_1;
-using std::placeholders::_2;
 
 const int ContextAlbumsModel::kPrettyCoverSize = 32;
 const qint64 ContextAlbumsModel::kIconCacheSize = 100000000;  //~100MB
@@ -80,6 +77,7 @@ ContextAlbumsModel::ContextAlbumsModel(CollectionBackend *backend, Application *
   cover_loader_options_.desired_height_ = kPrettyCoverSize;
   cover_loader_options_.pad_output_image_ = true;
   cover_loader_options_.scale_output_image_ = true;
+  cover_loader_options_.use_thumbnail_cache_ = true;
 
   connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)), SLOT(AlbumArtLoaded(quint64, QImage)));
 
@@ -148,8 +146,9 @@ QVariant ContextAlbumsModel::AlbumIcon(const QModelIndex &index) {
     return cached_pixmap;
   }
 
-  // Maybe we're loading a pixmap already?
+  // Maybe we're loading a pixmap already?  The item is being painted, so load it before the ones that have been scrolled out of view.
   if (pending_cache_keys_.contains(cache_key)) {
+    app_->album_cover_loader()->PrioritizeTasks(QSet<quint64>() << pending_cache_keys_.value(cache_key));
     return no_cover_icon_;
   }
 
@@ -158,7 +157,7 @@ QVariant ContextAlbumsModel::AlbumIcon(const QModelIndex &index) {
   if (!songs.isEmpty()) {
     const quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, songs.first());
     pending_art_[id] = ItemAndCacheKey(item, cache_key);
-    pending_cache_keys_.insert(cache_key);
+    pending_cache_keys_.insert(cache_key, id);
   }
 
   return no_cover_icon_;
@@ -323,6 +322,7 @@ void ContextAlbumsModel::PostQuery(CollectionItem *parent, const ContextAlbumsMo
     item->key = item->metadata.title();
     item->display_text = item->metadata.TitleWithCompilationArtist();
     item->sort_text = SortTextForSong(item->metadata);
+    item->UpdateSortKey(collator_);
     if (parent != root_) item->lazy_loaded = true;
 
     if (signal) endInsertRows();
@@ -369,6 +369,7 @@ CollectionItem *ContextAlbumsModel::ItemFromSong(CollectionItem::Type item_type,
   //if (item->key.isNull()) item->key = s.effective_albumartist();
   item->display_text = TextOrUnknown(item->key);
   item->sort_text = SortTextForArtist(item->key);
+  item->UpdateSortKey(collator_);
 
   if (item_type == CollectionItem::Type_Song) item->lazy_loaded = true;
   if (signal) endInsertRows();
@@ -465,14 +466,8 @@ QMimeData *ContextAlbumsModel::mimeData(const QModelIndexList &indexes) const {
 
 }
 
-bool ContextAlbumsModel::CompareItems(const CollectionItem *a, const CollectionItem *b) const {
-
-  QVariant left(data(a, ContextAlbumsModel::Role_SortText));
-  QVariant right(data(b, ContextAlbumsModel::Role_SortText));
-
-  if (left.type() == QVariant::Int) return left.toInt() < right.toInt();
-  return left.toString() < right.toString();
-
+bool ContextAlbumsModel::CompareItems(const CollectionItem *a, const CollectionItem *b) {
+  return CollectionItem::SortKeyLessThan(a, b);
 }
 
 void ContextAlbumsModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls, SongList *songs, QSet<int> *song_ids) const {
@@ -482,7 +477,7 @@ void ContextAlbumsModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls,
       const_cast<ContextAlbumsModel*>(this)->LazyPopulate(item);
 
       QList<CollectionItem*> children = item->children;
-      std::sort(children.begin(), children.end(), std::bind(&ContextAlbumsModel::CompareItems, this, _1, _2));
+      std::sort(children.begin(), children.end(), &ContextAlbumsModel::CompareItems);
 
       for (CollectionItem *child : children)
         GetChildSongs(child, urls, songs, song_ids);
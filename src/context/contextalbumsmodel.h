@@ -29,6 +29,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QAbstractItemModel>
+#include <QCollator>
 #include <QList>
 #include <QMap>
 #include <QPair>
@@ -119,7 +120,7 @@ class ContextAlbumsModel : public SimpleTreeModel<CollectionItem> {
   QString AlbumIconPixmapCacheKey(const QModelIndex &index) const;
   QVariant AlbumIcon(const QModelIndex &index);
   QVariant data(const CollectionItem *item, int role) const;
-  bool CompareItems(const CollectionItem *a, const CollectionItem *b) const;
+  static bool CompareItems(const CollectionItem *a, const CollectionItem *b);
 
  private:
   CollectionBackend *backend_;
@@ -127,6 +128,7 @@ class ContextAlbumsModel : public SimpleTreeModel<CollectionItem> {
   QueryOptions query_options_;
   QMap<int, CollectionItem*> song_nodes_;
   QMap<QString, CollectionItem*> container_nodes_;
+  QCollator collator_;
   QIcon artist_icon_;
   QIcon album_icon_;
   QPixmap no_cover_icon_;
@@ -137,7 +139,7 @@ class ContextAlbumsModel : public SimpleTreeModel<CollectionItem> {
   AlbumCoverLoaderOptions cover_loader_options_;
   typedef QPair<CollectionItem*, QString> ItemAndCacheKey;
   QMap<quint64, ItemAndCacheKey> pending_art_;
-  QSet<QString> pending_cache_keys_;
+  QMap<QString, quint64> pending_cache_keys_;
 };
 
 #endif  // CONTEXTALBUMSMODEL_H
@@ -0,0 +1,125 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "fileexistencechecker.h"
+
+FileExistenceChecker *FileExistenceChecker::sInstance = nullptr;
+
+const int FileExistenceChecker::kMaxThreads = 4;
+const int FileExistenceChecker::kCacheTimeoutMsec = 10000;
+
+FileExistenceChecker::FileExistenceChecker() {
+  pool_.setMaxThreadCount(kMaxThreads);
+}
+
+FileExistenceChecker *FileExistenceChecker::Instance() {
+
+  if (!sInstance) {
+    sInstance = new FileExistenceChecker;
+  }
+
+  return sInstance;
+
+}
+
+QSet<QString> FileExistenceChecker::Check(const QStringList &filenames) {
+
+  // Group the files by directory.
+  QHash<QString, QStringList> files_by_dir;
+  for (const QString &filename : filenames) {
+    if (filename.isEmpty()) continue;
+    QFileInfo info(filename);
+    files_by_dir[info.absolutePath()] << filename;
+  }
+
+  // Start listing the directories that aren't cached yet, directories that are already being listed for another check are shared.
+  QHash<QString, QFuture<QSet<QString>>> listings;
+  {
+    QMutexLocker l(&mutex_);
+
+    for (QHash<QString, Listing>::iterator it = listings_.begin() ; it != listings_.end() ;) {
+      if (it.value().age.hasExpired(kCacheTimeoutMsec)) it = listings_.erase(it);
+      else ++it;
+    }
+
+    for (const QString &dir : files_by_dir.keys()) {
+      if (!listings_.contains(dir)) {
+        Listing listing;
+        listing.entries = QtConcurrent::run(&pool_, &FileExistenceChecker::ListDirectory, dir);
+        listing.age.start();
+        listings_.insert(dir, listing);
+      }
+      listings.insert(dir, listings_[dir].entries);
+    }
+  }
+
+  QSet<QString> ret;
+  for (QHash<QString, QStringList>::const_iterator it = files_by_dir.constBegin() ; it != files_by_dir.constEnd() ; ++it) {
+    const QSet<QString> entries = listings[it.key()].result();
+    for (const QString &filename : it.value()) {
+      if (entries.contains(NormaliseFilename(QFileInfo(filename).fileName()))) ret << filename;
+    }
+  }
+
+  return ret;
+
+}
+
+void FileExistenceChecker::Clear() {
+
+  QMutexLocker l(&mutex_);
+  listings_.clear();
+
+}
+
+QSet<QString> FileExistenceChecker::ListDirectory(const QString &path) {
+
+  QSet<QString> ret;
+  for (const QString &entry : QDir(path).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot)) {
+    ret << NormaliseFilename(entry);
+  }
+  return ret;
+
+}
+
+QString FileExistenceChecker::NormaliseFilename(const QString &filename) {
+
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+  // The filesystems are case insensitive by default.
+  return filename.toLower();
+#else
+  return filename;
+#endif
+
+}
@@ -0,0 +1,67 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FILEEXISTENCECHECKER_H
+#define FILEEXISTENCECHECKER_H
+
+#include "config.h"
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QElapsedTimer>
+
+// Checks whether local files exist by listing each of their directories once, instead of stat'ing every file.
+// Directories are listed in parallel on a small thread pool, and the listings are kept for a short time so checking several playlists after each other only lists each directory once.
+class FileExistenceChecker {
+ public:
+  static FileExistenceChecker *Instance();
+
+  static const int kMaxThreads;
+  static const int kCacheTimeoutMsec;
+
+  // Returns the filenames that exist.  Blocks until all directories are listed, so this should be called from a worker thread.
+  // This method is thread-safe.
+  QSet<QString> Check(const QStringList &filenames);
+
+  void Clear();
+
+ private:
+  FileExistenceChecker();
+
+  struct Listing {
+    QFuture<QSet<QString>> entries;
+    QElapsedTimer age;
+  };
+
+  static QSet<QString> ListDirectory(const QString &path);
+  static QString NormaliseFilename(const QString &filename);
+
+  static FileExistenceChecker *sInstance;
+
+  QThreadPool pool_;
+  QMutex mutex_;
+  QHash<QString, Listing> listings_;
+};
+
+#endif  // FILEEXISTENCECHECKER_H
@@ -82,6 +82,7 @@
 #include "systemtrayicon.h"
 #include "application.h"
 #include "networkproxyfactory.h"
+#include "remotetypecache.h"
 #include "scangiomodulepath.h"
 
 #include "widgets/osd.h"
@@ -205,6 +206,9 @@ int main(int argc, char* argv[]) {
 
   QLoggingCategory::defaultCategory()->setEnabled(QtDebugMsg, true);
 
+  // Loaders use this from worker threads, so it has to exist before any of them start.
+  RemoteTypeCache::Create();
+
   Application app;
 
   // Network proxy
@@ -233,6 +237,8 @@ int main(int argc, char* argv[]) {
 
   int ret = a.exec();
 
+  RemoteTypeCache::Shutdown();
+
   main_exit_safe(ret);
 
   return ret;
@@ -105,6 +105,7 @@
 #include "collection/collectionquery.h"
 #include "collection/collectionview.h"
 #include "collection/collectionviewcontainer.h"
+#include "collection/collectionsortmodel.h"
 #include "playlist/playlist.h"
 #include "playlist/playlistbackend.h"
 #include "playlist/playlistcontainer.h"
@@ -216,7 +217,7 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
       playlist_menu_(new QMenu(this)),
       playlist_add_to_another_(nullptr),
       playlistitem_actions_separator_(nullptr),
-      collection_sort_model_(new QSortFilterProxyModel(this)),
+      collection_sort_model_(new CollectionSortModel(this)),
       track_position_timer_(new QTimer(this)),
       track_slider_timer_(new QTimer(this)),
       initialised_(false),
@@ -294,9 +295,6 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
   // Models
   qLog(Debug) << "Creating models";
   collection_sort_model_->setSourceModel(app_->collection()->model());
-  collection_sort_model_->setSortRole(CollectionModel::Role_SortText);
-  collection_sort_model_->setDynamicSortFilter(true);
-  collection_sort_model_->setSortLocaleAware(true);
   collection_sort_model_->sort(0);
 
   qLog(Debug) << "Creating models finished";
@@ -350,6 +348,7 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
   ui_->action_clear_playlist->setIcon(IconLoader::Load("edit-clear-list"));
   ui_->action_shuffle->setIcon(IconLoader::Load("media-playlist-shuffle"));
   ui_->action_remove_duplicates->setIcon(IconLoader::Load("list-remove"));
+  ui_->action_remove_duplicates_all->setIcon(IconLoader::Load("list-remove"));
   ui_->action_remove_unavailable->setIcon(IconLoader::Load("list-remove"));
 
   //ui_->action_remove_from_playlist->setIcon(IconLoader::Load("list-remove"));
@@ -387,6 +386,7 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
 
   connect(ui_->action_clear_playlist, SIGNAL(triggered()), app_->playlist_manager(), SLOT(ClearCurrent()));
   connect(ui_->action_remove_duplicates, SIGNAL(triggered()), app_->playlist_manager(), SLOT(RemoveDuplicatesCurrent()));
+  connect(ui_->action_remove_duplicates_all, SIGNAL(triggered()), app_->playlist_manager(), SLOT(RemoveDuplicatesAll()));
   connect(ui_->action_remove_unavailable, SIGNAL(triggered()), app_->playlist_manager(), SLOT(RemoveUnavailableCurrent()));
   connect(ui_->action_remove_from_playlist, SIGNAL(triggered()), SLOT(PlaylistRemoveCurrent()));
   connect(ui_->action_edit_track, SIGNAL(triggered()), SLOT(EditTracks()));
@@ -575,6 +575,7 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
   playlist_menu_->addAction(ui_->action_clear_playlist);
   playlist_menu_->addAction(ui_->action_shuffle);
   playlist_menu_->addAction(ui_->action_remove_duplicates);
+  playlist_menu_->addAction(ui_->action_remove_duplicates_all);
   playlist_menu_->addAction(ui_->action_remove_unavailable);
 
 #ifdef Q_OS_MACOS
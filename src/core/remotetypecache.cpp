@@ -0,0 +1,246 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QTimer>
+#include <QStandardPaths>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "core/logging.h"
+#include "network.h"
+#include "remotetypecache.h"
+
+RemoteTypeCache *RemoteTypeCache::sInstance = nullptr;
+
+const int RemoteTypeCache::kMaxAgeSecs = 60 * 60 * 24;  // 1 day
+const int RemoteTypeCache::kMaxContentSize = 32768;
+const int RemoteTypeCache::kMaxEntries = 500;
+const int RemoteTypeCache::kRevalidateTimeoutMsec = 5000;
+const int RemoteTypeCache::kSaveIntervalSecs = 60;
+const quint32 RemoteTypeCache::kFileVersion = 1;
+
+RemoteTypeCache::RemoteTypeCache() : loaded_(false), dirty_(false), last_saved_(0) {}
+
+void RemoteTypeCache::Create() {
+
+  if (!sInstance) {
+    sInstance = new RemoteTypeCache;
+  }
+
+}
+
+void RemoteTypeCache::Shutdown() {
+
+  if (sInstance) sInstance->SaveIfNeeded(true);
+
+}
+
+QString RemoteTypeCache::CacheFilename() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/remotetypes";
+}
+
+bool RemoteTypeCache::Lookup(const QUrl &url, Entry *entry) {
+
+  Entry cached;
+  {
+    QMutexLocker l(&mutex_);
+    LoadIfNeeded();
+    if (!entries_.contains(url)) return false;
+    cached = entries_[url];
+  }
+
+  const qint64 now = QDateTime::currentDateTime().toTime_t();
+  if (now - cached.checked < kMaxAgeSecs) {
+    *entry = cached;
+    return true;
+  }
+
+  // The entry is too old, check if the server still has the same thing.
+  const bool valid = Revalidate(url, &cached);
+
+  {
+    QMutexLocker l(&mutex_);
+    if (valid) {
+      cached.checked = now;
+      entries_[url] = cached;
+    }
+    else {
+      qLog(Debug) << "Cached type of" << url << "is out of date";
+      entries_.remove(url);
+    }
+    dirty_ = true;
+  }
+  SaveIfNeeded(false);
+
+  if (!valid) return false;
+
+  *entry = cached;
+  return true;
+
+}
+
+void RemoteTypeCache::Insert(const QUrl &url, const Entry &entry) {
+
+  if (entry.type == Type_Playlist && entry.content.size() > kMaxContentSize) return;
+
+  {
+    QMutexLocker l(&mutex_);
+    LoadIfNeeded();
+
+    entries_[url] = entry;
+    entries_[url].checked = QDateTime::currentDateTime().toTime_t();
+
+    // Forget the entry that was checked longest ago.
+    if (entries_.count() > kMaxEntries) {
+      QHash<QUrl, Entry>::iterator oldest = entries_.begin();
+      for (QHash<QUrl, Entry>::iterator it = entries_.begin() ; it != entries_.end() ; ++it) {
+        if (it.value().checked < oldest.value().checked) oldest = it;
+      }
+      entries_.erase(oldest);
+    }
+
+    dirty_ = true;
+  }
+  SaveIfNeeded(false);
+
+}
+
+bool RemoteTypeCache::Revalidate(const QUrl &url, Entry *entry) {
+
+  // Only http has validators, everything else has to be probed again.
+  if (url.scheme() != "http" && url.scheme() != "https") return false;
+  if (entry->etag.isEmpty() && entry->last_modified.isEmpty()) return false;
+
+  QNetworkRequest req(url);
+  req.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+  if (!entry->etag.isEmpty()) req.setRawHeader("If-None-Match", entry->etag);
+  if (!entry->last_modified.isEmpty()) req.setRawHeader("If-Modified-Since", entry->last_modified);
+
+  NetworkAccessManager network;
+  QNetworkReply *reply = network.head(req);
+
+  QEventLoop loop;
+  QTimer timeout;
+  timeout.setSingleShot(true);
+  QObject::connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+  QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+  timeout.start(kRevalidateTimeoutMsec);
+  loop.exec();
+
+  if (!reply->isFinished() || reply->error() != QNetworkReply::NoError) {
+    reply->abort();
+    return false;
+  }
+
+  const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status == 304) return true;
+  if (status != 200) return false;
+
+  // Not all servers answer conditional HEAD requests, so compare the validators as well.
+  const QByteArray etag = reply->rawHeader("ETag");
+  const QByteArray last_modified = reply->rawHeader("Last-Modified");
+  if (!entry->etag.isEmpty()) return etag == entry->etag;
+  return !last_modified.isEmpty() && last_modified == entry->last_modified;
+
+}
+
+void RemoteTypeCache::LoadIfNeeded() {
+
+  if (loaded_) return;
+  loaded_ = true;
+
+  QFile file(CacheFilename());
+  if (!file.open(QIODevice::ReadOnly)) return;
+
+  QDataStream s(&file);
+  quint32 version = 0;
+  s >> version;
+  if (version != kFileVersion) return;
+
+  qint32 count = 0;
+  s >> count;
+  for (qint32 i = 0 ; i < count && s.status() == QDataStream::Ok ; ++i) {
+    QUrl url;
+    qint32 type = 0;
+    Entry entry;
+    s >> url >> type >> entry.url >> entry.mime_type >> entry.content >> entry.etag >> entry.last_modified >> entry.checked;
+    entry.type = Type(type);
+    if (s.status() == QDataStream::Ok) entries_[url] = entry;
+  }
+
+}
+
+void RemoteTypeCache::SaveIfNeeded(bool force) {
+
+  QMutexLocker save_locker(&save_mutex_);
+
+  QHash<QUrl, Entry> entries;
+  {
+    QMutexLocker l(&mutex_);
+    if (!dirty_) return;
+    const qint64 now = QDateTime::currentDateTime().toTime_t();
+    if (!force && now - last_saved_ < kSaveIntervalSecs) return;
+    dirty_ = false;
+    last_saved_ = now;
+    entries = entries_;
+  }
+
+  if (!Save(entries)) {
+    QMutexLocker l(&mutex_);
+    dirty_ = true;
+  }
+
+}
+
+bool RemoteTypeCache::Save(const QHash<QUrl, Entry> &entries) {
+
+  QDir().mkpath(QFileInfo(CacheFilename()).path());
+
+  QSaveFile file(CacheFilename());
+  if (!file.open(QIODevice::WriteOnly)) {
+    qLog(Warning) << "Failed to write" << CacheFilename();
+    return false;
+  }
+
+  QDataStream s(&file);
+  s << kFileVersion << qint32(entries.count());
+  for (QHash<QUrl, Entry>::const_iterator it = entries.constBegin() ; it != entries.constEnd() ; ++it) {
+    const Entry &entry = it.value();
+    s << it.key() << qint32(entry.type) << entry.url << entry.mime_type << entry.content << entry.etag << entry.last_modified << entry.checked;
+  }
+
+  return file.commit();
+
+}
@@ -0,0 +1,100 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef REMOTETYPECACHE_H
+#define REMOTETYPECACHE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+
+// Remembers what remote URLs turned out to be when SongLoader probed them, so adding the same streams again doesn't need a typefind pipeline for each of them.
+// Small playlists are kept together with their content.  Entries are used as they are for kMaxAgeSecs,
+// after that http URLs are revalidated with a HEAD request using the ETag and Last-Modified headers seen when probing, and other URLs are probed again.
+// The cache is saved to disk at most once per kSaveIntervalSecs and when the application quits, all methods are thread-safe.
+class RemoteTypeCache {
+ public:
+  // Creates the instance.  Call it from main() before any SongLoader runs, Instance() is used from worker threads so it doesn't create it.
+  static void Create();
+  static RemoteTypeCache *Instance() { return sInstance; }
+  // Saves unsaved changes.  Call it after the event loop has quit, the instance is kept for loaders that are still running.
+  static void Shutdown();
+
+  static const int kMaxAgeSecs;
+  static const int kMaxContentSize;
+  static const int kMaxEntries;
+  static const int kRevalidateTimeoutMsec;
+  static const int kSaveIntervalSecs;
+
+  enum Type {
+    Type_Stream = 0,
+    Type_Playlist = 1,
+  };
+
+  struct Entry {
+    Entry() : type(Type_Stream), checked(0) {}
+
+    Type type;
+    // The URL to play, this may differ from the probed URL, for example MS-WMSP streams are changed to mms.
+    QUrl url;
+    // For playlists, the content and the mime type found by typefind, used to pick the parser again.
+    QString mime_type;
+    QByteArray content;
+    QByteArray etag;
+    QByteArray last_modified;
+    // When the URL was last probed or revalidated, in seconds since the epoch.
+    qint64 checked;
+  };
+
+  // Returns true and sets entry if there is a valid entry for the URL.  This may block on a network request, so don't call it from the UI thread.
+  bool Lookup(const QUrl &url, Entry *entry);
+  void Insert(const QUrl &url, const Entry &entry);
+
+ private:
+  RemoteTypeCache();
+
+  static QString CacheFilename();
+  static bool Revalidate(const QUrl &url, Entry *entry);
+
+  void LoadIfNeeded();
+  // Writes the cache if it changed, unless it was written less than kSaveIntervalSecs ago and force isn't set.
+  // The entries are copied so the file is written without holding mutex_.
+  void SaveIfNeeded(bool force);
+  static bool Save(const QHash<QUrl, Entry> &entries);
+
+  // Changed whenever the format of the cache file changes, older files are ignored.
+  static const quint32 kFileVersion;
+
+  static RemoteTypeCache *sInstance;
+
+  QMutex mutex_;
+  bool loaded_;
+  QHash<QUrl, Entry> entries_;
+  bool dirty_;
+  qint64 last_saved_;
+  // Keeps saves in order, so an older copy of the entries never replaces a newer one.
+  QMutex save_mutex_;
+};
+
+#endif  // REMOTETYPECACHE_H
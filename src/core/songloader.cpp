@@ -38,6 +38,8 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QList>
+#include <QHash>
+#include <QPair>
 #include <QSet>
 #include <QTimer>
 #include <QString>
@@ -49,6 +51,7 @@
 
 #include "signalchecker.h"
 #include "player.h"
+#include "remotetypecache.h"
 #include "song.h"
 #include "songloader.h"
 #include "tagreaderclient.h"
@@ -72,8 +75,10 @@ using std::shared_ptr;
 
 QSet<QString> SongLoader::sRawUriSchemes;
 const int SongLoader::kDefaultTimeout = 5000;
+const int SongLoader::kMaxPendingReads = 64;
+const int SongLoader::kMetadataBatchSize = 500;
 
-SongLoader::SongLoader(CollectionBackendInterface *collection, const Player *player, QObject *parent) :
+SongLoader::SongLoader(CollectionBackendInterface *collection, const Player *player, TaskManager *task_manager, QObject *parent) :
       QObject(parent),
       timeout_timer_(new QTimer(this)),
       playlist_parser_(new PlaylistParser(collection, this)),
@@ -99,6 +104,9 @@ SongLoader::SongLoader(CollectionBackendInterface *collection, const Player *pla
 
   timeout_timer_->setSingleShot(true);
 
+  playlist_parser_->set_task_manager(task_manager);
+  cue_parser_->set_task_manager(task_manager);
+
   connect(timeout_timer_, SIGNAL(timeout()), SLOT(Timeout()));
 
 }
@@ -253,10 +261,7 @@ void SongLoader::LoadLocalAsync(const QString &filename) {
   QString matching_cue = filename.section('.', 0, -2) + ".cue";
   if (QFile::exists(matching_cue)) {
     // it's a cue - create virtual tracks
-    QFile cue(matching_cue);
-    cue.open(QIODevice::ReadOnly);
-
-    SongList song_list = cue_parser_->Load(&cue, matching_cue, QDir(filename.section('/', 0, -2)));
+    SongList song_list = cue_parser_->LoadFile(matching_cue, QDir(filename.section('/', 0, -2)));
     for (Song song: song_list){
       if (song.is_valid()) songs_ << song;
     }
@@ -270,10 +275,60 @@ void SongLoader::LoadLocalAsync(const QString &filename) {
 
 }
 
+void SongLoader::LoadFirstSongBlocking() {
+  if (!songs_.isEmpty()) EffectiveSongLoad(&songs_[0]);
+}
+
 void SongLoader::LoadMetadataBlocking() {
-  for (int i = 0; i < songs_.size(); i++) {
-    EffectiveSongLoad(&songs_[i]);
+
+  // Search for all songs in the collection at once.
+  QList<QUrl> urls;
+  for (const Song &song : songs_) {
+    if (song.filetype() == Song::FileType_Unknown) urls << song.url();
+  }
+
+  QHash<QUrl, Song> collection_songs;
+  if (!urls.isEmpty()) {
+    for (const Song &song : collection_->GetSongsByUrls(urls)) {
+      if (song.beginning_nanosec() == 0) collection_songs.insert(song.url(), song);
+    }
+  }
+
+  // Read the tags of the rest, keeping a number of files queued so all tagreader workers are busy.
+  // Songs are emitted in order as soon as a batch of them is loaded.
+  QList<QPair<int, TagReaderReply*>> pending;
+  int next = 0;
+  int emitted = 0;
+  while (next < songs_.count() || !pending.isEmpty()) {
+    while (next < songs_.count() && pending.count() < kMaxPendingReads) {
+      Song &song = songs_[next];
+      // Maybe we loaded the metadata already, for example from a cuesheet.
+      if (song.filetype() == Song::FileType_Unknown) {
+        if (collection_songs.contains(song.url())) {
+          song = collection_songs[song.url()];
+        }
+        else {
+          pending << qMakePair(next, TagReaderClient::Instance()->ReadFile(song.url().toLocalFile()));
+        }
+      }
+      ++next;
+    }
+
+    if (!pending.isEmpty()) {
+      QPair<int, TagReaderReply*> read = pending.takeFirst();
+      if (read.second->WaitForFinished()) {
+        songs_[read.first].InitFromProtobuf(read.second->message().read_file_response().metadata());
+      }
+      read.second->deleteLater();
+    }
+
+    const int loaded = pending.isEmpty() ? next : pending.first().first;
+    if (loaded - emitted >= kMetadataBatchSize || (loaded == songs_.count() && loaded > emitted)) {
+      emit SongsMetadataLoaded(songs_.mid(emitted, loaded - emitted));
+      emitted = loaded;
+    }
   }
+
 }
 
 void SongLoader::EffectiveSongLoad(Song *song) {
@@ -299,9 +354,24 @@ void SongLoader::EffectiveSongLoad(Song *song) {
 }
 
 void SongLoader::LoadPlaylist(ParserBase *parser, const QString &filename) {
+
   QFile file(filename);
-  file.open(QIODevice::ReadOnly);
-  songs_ = parser->Load(&file, filename, QFileInfo(filename).path());
+  if (!file.open(QIODevice::ReadOnly)) return;
+
+  // Map the file instead of reading it, so only the part being parsed needs to be in memory.
+  QByteArray data;
+  QBuffer buffer;
+  QIODevice *device = &file;
+  uchar *mapped = file.size() > 0 ? file.map(0, file.size()) : nullptr;
+  if (mapped) {
+    data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), file.size());
+    buffer.setBuffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    device = &buffer;
+  }
+
+  parser->LoadStreaming(device, filename, QFileInfo(filename).path(), [this](const SongList &songs) { emit PlaylistSongsLoaded(songs); });
+
 }
 
 static bool CompareSongs(const Song &left, const Song &right) {
@@ -370,12 +440,28 @@ void SongLoader::StopTypefind() {
     buf.open(QIODevice::ReadOnly);
     songs_ = parser_->Load(&buf);
 
+    RemoteTypeCache::Entry entry;
+    entry.type = RemoteTypeCache::Type_Playlist;
+    entry.url = url_;
+    entry.mime_type = mime_type_;
+    entry.content = buffer_;
+    entry.etag = etag_;
+    entry.last_modified = last_modified_;
+    RemoteTypeCache::Instance()->Insert(remote_url_, entry);
+
   }
   else if (success_) {
     qLog(Debug) << "Loading" << url_ << "as raw stream";
 
     // It wasn't a playlist - just put the URL in as a stream
     AddAsRawStream();
+
+    RemoteTypeCache::Entry entry;
+    entry.type = RemoteTypeCache::Type_Stream;
+    entry.url = url_;
+    entry.etag = etag_;
+    entry.last_modified = last_modified_;
+    RemoteTypeCache::Instance()->Insert(remote_url_, entry);
   }
 
   emit LoadRemoteFinished();
@@ -387,6 +473,9 @@ void SongLoader::LoadRemote() {
 
   qLog(Debug) << "Loading remote file" << url_;
 
+  remote_url_ = url_;
+  if (LoadRemoteFromCache()) return;
+
   // It's not a local file so we have to fetch it to see what it is.
   // We use gstreamer to do this since it handles funky URLs for us (http://, ssh://, etc) and also has typefinder plugins.
   // First we wait for typefinder to tell us what it is.  If it's not text/plain or text/uri-list assume it's a song and return success.
@@ -435,6 +524,31 @@ void SongLoader::LoadRemote() {
 }
 #endif
 
+#ifdef HAVE_GSTREAMER
+bool SongLoader::LoadRemoteFromCache() {
+
+  RemoteTypeCache::Entry entry;
+  if (!RemoteTypeCache::Instance()->Lookup(url_, &entry)) return false;
+
+  if (entry.type == RemoteTypeCache::Type_Playlist) {
+    ParserBase *parser = playlist_parser_->ParserForMagic(entry.content, entry.mime_type);
+    if (!parser) return false;
+
+    qLog(Debug) << "Parsing cached" << url_ << "with" << parser->name();
+    QBuffer buf(&entry.content);
+    buf.open(QIODevice::ReadOnly);
+    songs_ = parser->Load(&buf);
+    return true;
+  }
+
+  qLog(Debug) << "Loading cached" << url_ << "as raw stream";
+  url_ = entry.url;
+  AddAsRawStream();
+  return true;
+
+}
+#endif
+
 #ifdef HAVE_GSTREAMER
 void SongLoader::TypeFound(GstElement *, uint, GstCaps *caps, void *self) {
 
@@ -515,6 +629,10 @@ GstBusSyncReply SongLoader::BusCallbackSync(GstBus *, GstMessage *msg, gpointer
       instance->ErrorMessageReceived(msg);
       break;
 
+    case GST_MESSAGE_ELEMENT:
+      instance->ElementMessageReceived(msg);
+      break;
+
     default:
       break;
   }
@@ -550,6 +668,28 @@ void SongLoader::ErrorMessageReceived(GstMessage *msg) {
 }
 #endif
 
+#ifdef HAVE_GSTREAMER
+void SongLoader::ElementMessageReceived(GstMessage *msg) {
+
+  // souphttpsrc posts the response headers, keep the validators so the cached type can be revalidated later.
+  const GstStructure *structure = gst_message_get_structure(msg);
+  if (!structure || !gst_structure_has_name(structure, "http-headers")) return;
+
+  const GValue *value = gst_structure_get_value(structure, "response-headers");
+  if (!value || !GST_VALUE_HOLDS_STRUCTURE(value)) return;
+  const GstStructure *headers = gst_value_get_structure(value);
+
+  for (int i = 0 ; i < gst_structure_n_fields(headers) ; ++i) {
+    const QString name = gst_structure_nth_field_name(headers, i);
+    const gchar *header = gst_structure_get_string(headers, gst_structure_nth_field_name(headers, i));
+    if (!header) continue;
+    if (name.compare("ETag", Qt::CaseInsensitive) == 0) etag_ = header;
+    else if (name.compare("Last-Modified", Qt::CaseInsensitive) == 0) last_modified_ = header;
+  }
+
+}
+#endif
+
 #ifdef HAVE_GSTREAMER
 void SongLoader::EndOfStreamReached() {
 
@@ -48,6 +48,7 @@ class CollectionBackendInterface;
 class PlaylistParser;
 class ParserBase;
 class CueParser;
+class TaskManager;
 
 #if defined(HAVE_AUDIOCD) && defined(HAVE_GSTREAMER)
 class CddaSongLoader;
@@ -56,7 +57,7 @@ class CddaSongLoader;
 class SongLoader : public QObject {
   Q_OBJECT
  public:
-  SongLoader(CollectionBackendInterface *collection, const Player *player, QObject *parent = nullptr);
+  SongLoader(CollectionBackendInterface *collection, const Player *player, TaskManager *task_manager, QObject *parent = nullptr);
   ~SongLoader();
 
   enum Result {
@@ -66,6 +67,8 @@ class SongLoader : public QObject {
   };
 
   static const int kDefaultTimeout;
+  static const int kMaxPendingReads;
+  static const int kMetadataBatchSize;
 
   const QUrl &url() const { return url_; }
   const SongList &songs() const { return songs_; }
@@ -76,14 +79,21 @@ class SongLoader : public QObject {
   // If Success is returned the songs are fully loaded. If BlockingLoadRequired is returned LoadFilenamesBlocking() needs to be called next.
   Result Load(const QUrl &url);
   // Loads the files with only filenames. When finished, songs() contains a complete list of all Song objects, but without metadata.
+  // Local playlists are the exception, their songs are loaded completely and emitted in batches with PlaylistSongsLoaded() while the playlist is parsed instead of being added to songs().
   // This method is blocking, do not call it from the UI thread.
   void LoadFilenamesBlocking();
-  // Completely load songs previously loaded with LoadFilenamesBlocking().
+  // Completely load the first song previously loaded with LoadFilenamesBlocking(), so it can be played right away.
+  // This method is blocking, do not call it from the UI thread.
+  void LoadFirstSongBlocking();
+  // Completely load songs previously loaded with LoadFilenamesBlocking(), reading the tags in parallel in the tagreader workers.
+  // The loaded songs are emitted in batches with SongsMetadataLoaded() while they are read.
   // When finished, the Song objects in songs() contain metadata now. This method is blocking, do not call it from the UI thread.
   void LoadMetadataBlocking();
   Result LoadAudioCD();
 
 signals:
+  void PlaylistSongsLoaded(const SongList &songs);
+  void SongsMetadataLoaded(const SongList &songs);
   void AudioCDTracksLoaded();
   void LoadAudioCDFinished(bool success);
   void LoadRemoteFinished();
@@ -110,6 +120,8 @@ signals:
 
 #ifdef HAVE_GSTREAMER
   void LoadRemote();
+  // Loads the URL using the type found when it was probed before.  Returns false if it's not cached.
+  bool LoadRemoteFromCache();
 
   // GStreamer callbacks
   static void TypeFound(GstElement *typefind, uint probability, GstCaps *caps, void *self);
@@ -119,6 +131,7 @@ signals:
 
   void StopTypefindAsync(bool success);
   void ErrorMessageReceived(GstMessage *msg);
+  void ElementMessageReceived(GstMessage *msg);
   void EndOfStreamReached();
   void MagicReady();
   bool IsPipelinePlaying();
@@ -142,6 +155,10 @@ signals:
   ParserBase *parser_;
   QString mime_type_;
   QByteArray buffer_;
+  // The URL as it was before probing it, used as key in the RemoteTypeCache.
+  QUrl remote_url_;
+  QByteArray etag_;
+  QByteArray last_modified_;
   CollectionBackendInterface *collection_;
   const Player *player_;
 
@@ -20,19 +20,27 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <functional>
+
 #include <QtGlobal>
 #include <QObject>
-#include <QQueue>
+#include <QtConcurrentRun>
+#include <QThread>
+#include <QThreadPool>
 #include <QMutex>
 #include <QStandardPaths>
 #include <QSize>
 #include <QList>
+#include <QMap>
+#include <QHash>
 #include <QSet>
 #include <QVariant>
 #include <QString>
 #include <QStringBuilder>
 #include <QUrl>
 #include <QImage>
+#include <QImageReader>
 #include <QPixmap>
 #include <QPainter>
 #include <QNetworkReply>
@@ -44,12 +52,29 @@
 #include "core/tagreaderclient.h"
 #include "albumcoverloader.h"
 #include "albumcoverloaderoptions.h"
+#include "albumcoverthumbnailcache.h"
 
 AlbumCoverLoader::AlbumCoverLoader(QObject *parent)
     : QObject(parent),
-      stop_requested_(false),
+      stop_requested_(0),
+      next_front_key_(0),
+      next_back_key_(0),
       next_id_(1),
-      network_(new NetworkAccessManager(this)){}
+      active_workers_(0),
+      network_(new NetworkAccessManager(this)),
+      thumbnail_cache_(new AlbumCoverThumbnailCache) {
+
+  pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+}
+
+AlbumCoverLoader::~AlbumCoverLoader() {
+
+  stop_requested_.store(1);
+  pool_.waitForDone();
+  delete thumbnail_cache_;
+
+}
 
 QString AlbumCoverLoader::ImageCacheDir() {
   return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/albumcovers";
@@ -58,25 +83,38 @@ QString AlbumCoverLoader::ImageCacheDir() {
 void AlbumCoverLoader::CancelTask(quint64 id) {
 
   QMutexLocker l(&mutex_);
-  for (QQueue<Task>::iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
-    if (it->id == id) {
-      tasks_.erase(it);
-      break;
-    }
-  }
+  if (task_keys_.contains(id)) tasks_.remove(task_keys_.take(id));
+
 }
 
 void AlbumCoverLoader::CancelTasks(const QSet<quint64> &ids) {
 
   QMutexLocker l(&mutex_);
-  for (QQueue<Task>::iterator it = tasks_.begin(); it != tasks_.end();) {
-    if (ids.contains(it->id)) {
-      it = tasks_.erase(it);
-    }
-    else {
-      ++it;
-    }
+  for (quint64 id : ids) {
+    if (task_keys_.contains(id)) tasks_.remove(task_keys_.take(id));
   }
+
+}
+
+void AlbumCoverLoader::PrioritizeTasks(const QSet<quint64> &ids) {
+
+  // This is called every time a view paints a cover that isn't loaded yet, so only the given tasks are looked at.
+  QMutexLocker l(&mutex_);
+
+  QList<qint64> keys;
+  for (quint64 id : ids) {
+    if (task_keys_.contains(id)) keys << task_keys_[id];
+  }
+
+  // Move them to the front from the back, so they keep their order among each other.
+  std::sort(keys.begin(), keys.end(), std::greater<qint64>());
+  for (qint64 key : keys) {
+    const Task task = tasks_.take(key);
+    const qint64 new_key = --next_front_key_;
+    tasks_.insert(new_key, task);
+    task_keys_[task.id] = new_key;
+  }
+
 }
 
 quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions& options, const Song &song) {
@@ -96,31 +134,60 @@ quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions &options,
   {
     QMutexLocker l(&mutex_);
     task.id = next_id_++;
-    tasks_.enqueue(task);
+    const qint64 key = next_back_key_++;
+    tasks_.insert(key, task);
+    task_keys_.insert(task.id, key);
   }
 
-  metaObject()->invokeMethod(this, "ProcessTasks", Qt::QueuedConnection);
+  ProcessTasks();
 
   return task.id;
 }
 
 void AlbumCoverLoader::ProcessTasks() {
 
-  while (!stop_requested_) {
-    // Get the next task
+  // Start another worker for each queued task until the pool is full.
+  QMutexLocker l(&mutex_);
+  while (!stop_requested_.load() && active_workers_ < pool_.maxThreadCount() && active_workers_ < tasks_.count()) {
+    ++active_workers_;
+    QtConcurrent::run(&pool_, this, &AlbumCoverLoader::WorkerLoop);
+  }
+
+}
+
+void AlbumCoverLoader::WorkerLoop() {
+
+  forever {
+    // Get the task with the highest priority
     Task task;
     {
       QMutexLocker l(&mutex_);
-      if (tasks_.isEmpty()) return;
-      task = tasks_.dequeue();
+      if (stop_requested_.load() || tasks_.isEmpty()) {
+        --active_workers_;
+        return;
+      }
+      task = tasks_.take(tasks_.firstKey());
+      task_keys_.remove(task.id);
     }
 
     ProcessTask(&task);
   }
+
 }
 
 void AlbumCoverLoader::ProcessTask(Task *task) {
 
+  // Use a thumbnail from an earlier load of the same image if we have one, so we don't have to decode the full size image.
+  const QString thumbnail_filename = ThumbnailFilename(*task);
+  if (!thumbnail_filename.isEmpty()) {
+    QImage thumbnail = thumbnail_cache_->Find(task->options, thumbnail_filename);
+    if (!thumbnail.isNull()) {
+      emit ImageLoaded(task->id, thumbnail);
+      emit ImageLoaded(task->id, thumbnail, thumbnail);
+      return;
+    }
+  }
+
   TryLoadResult result = TryLoadImage(*task);
   if (result.started_async) {
     // The image is being loaded from a remote URL, we'll carry on later when it's done
@@ -129,6 +196,7 @@ void AlbumCoverLoader::ProcessTask(Task *task) {
 
   if (result.loaded_success) {
     QImage scaled = ScaleAndPad(task->options, result.image);
+    if (!thumbnail_filename.isEmpty()) thumbnail_cache_->Insert(task->options, thumbnail_filename, scaled);
     emit ImageLoaded(task->id, scaled);
     emit ImageLoaded(task->id, scaled, result.image);
     return;
@@ -152,6 +220,28 @@ void AlbumCoverLoader::NextState(Task *task) {
 
 }
 
+QString AlbumCoverLoader::ThumbnailFilename(const Task &task) {
+
+  if (!task.options.use_thumbnail_cache_ || !task.options.scale_output_image_ || !task.embedded_image.isNull()) return QString();
+
+  QString filename;
+  switch (task.state) {
+    case State_TryingAuto:   filename = task.art_automatic; break;
+    case State_TryingManual: filename = task.art_manual;    break;
+  }
+
+  if (filename.isEmpty() || filename == Song::kManuallyUnsetCover) return QString();
+
+  // Embedded covers change with the song file itself.
+  if (filename == Song::kEmbeddedCover) return task.song_filename;
+
+  // Remote images are cached by the network disk cache.
+  if (filename.toLower().startsWith("http://") || filename.toLower().startsWith("https://")) return QString();
+
+  return filename;
+
+}
+
 AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(const Task &task) {
 
   // An image embedded in the song itself takes priority
@@ -176,11 +266,13 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(const Task &task)
 
   if (filename.toLower().startsWith("http://") || filename.toLower().startsWith("https://")) {
 
-    QUrl url(filename);
-    QNetworkReply *reply = network_->get(QNetworkRequest(url));
-    NewClosure(reply, SIGNAL(finished()), this, SLOT(RemoteFetchFinished(QNetworkReply*)), reply);
+    // The network access manager lives in our own thread, hand the task over to it.
+    {
+      QMutexLocker l(&mutex_);
+      remote_queue_ << qMakePair(QUrl(filename), task);
+    }
+    metaObject()->invokeMethod(this, "StartRemoteFetches", Qt::QueuedConnection);
 
-    remote_tasks_.insert(reply, task);
     return TryLoadResult(true, false, QImage());
   }
   else if (filename.isEmpty()) {
@@ -188,11 +280,38 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(const Task &task)
     return TryLoadResult(false, false, task.options.default_output_image_);
   }
 
-  QImage image(filename);
+  QImageReader reader(filename);
+  if (task.options.use_thumbnail_cache_ && task.options.scale_output_image_) {
+    // Only the scaled image is used, so let the image format decode it directly at the target size.
+    const QSize size = reader.size();
+    const QSize desired_size(task.options.desired_height_, task.options.desired_height_);
+    if (size.isValid() && (size.width() > desired_size.width() || size.height() > desired_size.height())) {
+      reader.setScaledSize(size.scaled(desired_size, Qt::KeepAspectRatio));
+    }
+  }
+
+  QImage image = reader.read();
   return TryLoadResult(false, !image.isNull(), image.isNull() ? task.options.default_output_image_ : image);
 
 }
 
+void AlbumCoverLoader::StartRemoteFetches() {
+
+  QList<QPair<QUrl, Task>> remote_queue;
+  {
+    QMutexLocker l(&mutex_);
+    remote_queue.swap(remote_queue_);
+  }
+
+  for (const QPair<QUrl, Task> &remote_task : remote_queue) {
+    QNetworkReply *reply = network_->get(QNetworkRequest(remote_task.first));
+    NewClosure(reply, SIGNAL(finished()), this, SLOT(RemoteFetchFinished(QNetworkReply*)), reply);
+
+    remote_tasks_.insert(reply, remote_task.second);
+  }
+
+}
+
 void AlbumCoverLoader::RemoteFetchFinished(QNetworkReply *reply) {
 
   reply->deleteLater();
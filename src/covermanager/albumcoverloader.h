@@ -28,10 +28,15 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QMutex>
-#include <QQueue>
+#include <QAtomicInt>
+#include <QThreadPool>
+#include <QList>
+#include <QHash>
 #include <QMap>
+#include <QPair>
 #include <QSet>
 #include <QString>
+#include <QUrl>
 #include <QImage>
 #include <QPixmap>
 #include <QNetworkReply>
@@ -41,14 +46,19 @@
 
 class Song;
 class NetworkAccessManager;
+class AlbumCoverThumbnailCache;
 
+// Loads album covers in a pool of worker threads.
+// Pending tasks are kept in a priority queue, views can move the covers that are on screen to the front with PrioritizeTasks().
+// The loader object itself lives in its own thread where the remote images are fetched.
 class AlbumCoverLoader : public QObject {
   Q_OBJECT
 
  public:
   explicit AlbumCoverLoader(QObject *parent = nullptr);
+  ~AlbumCoverLoader();
 
-  void Stop() { stop_requested_ = true; }
+  void Stop() { stop_requested_.store(1); }
 
   static QString ImageCacheDir();
 
@@ -57,6 +67,8 @@ class AlbumCoverLoader : public QObject {
 
   void CancelTask(quint64 id);
   void CancelTasks(const QSet<quint64> &ids);
+  // Moves the tasks to the front of the queue, the most recently prioritized tasks are loaded first.
+  void PrioritizeTasks(const QSet<quint64> &ids);
 
   static QPixmap TryLoadPixmap(const QString &automatic, const QString &manual, const QString &filename = QString());
   static QImage ScaleAndPad(const AlbumCoverLoaderOptions &options, const QImage &image);
@@ -67,6 +79,7 @@ signals:
 
  protected slots:
   void ProcessTasks();
+  void StartRemoteFetches();
   void RemoteFetchFinished(QNetworkReply *reply);
 
  protected:
@@ -97,18 +110,30 @@ signals:
     QImage image;
   };
 
+  void WorkerLoop();
   void ProcessTask(Task *task);
   void NextState(Task *task);
   TryLoadResult TryLoadImage(const Task &task);
+  static QString ThumbnailFilename(const Task &task);
 
-  bool stop_requested_;
+  // Read by the workers without holding mutex_.
+  QAtomicInt stop_requested_;
 
   QMutex mutex_;
-  QQueue<Task> tasks_;
+  // Queued tasks by their place in the queue: prioritized tasks have negative keys, most recently prioritized first, the rest follow in the order they were added.
+  QMap<qint64, Task> tasks_;
+  // The key in tasks_ of each queued task by ID, so tasks can be cancelled or prioritized without searching the queue.
+  QHash<quint64, qint64> task_keys_;
+  qint64 next_front_key_;
+  qint64 next_back_key_;
+  QList<QPair<QUrl, Task>> remote_queue_;
   QMap<QNetworkReply *, Task> remote_tasks_;
   quint64 next_id_;
+  int active_workers_;
 
   NetworkAccessManager *network_;
+  AlbumCoverThumbnailCache *thumbnail_cache_;
+  QThreadPool pool_;
 
   static const int kMaxRedirects = 3;
 };
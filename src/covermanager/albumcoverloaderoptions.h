@@ -30,11 +30,15 @@ struct AlbumCoverLoaderOptions {
   AlbumCoverLoaderOptions()
       : desired_height_(120),
         scale_output_image_(true),
-        pad_output_image_(true) {}
+        pad_output_image_(true),
+        use_thumbnail_cache_(false) {}
 
   int desired_height_;
   bool scale_output_image_;
   bool pad_output_image_;
+  // Only the scaled image is needed: it's decoded at the target size and kept in AlbumCoverThumbnailCache.
+  // The original image in ImageLoaded is then the scaled image too.
+  bool use_thumbnail_cache_;
   QImage default_output_image_;
 };
 
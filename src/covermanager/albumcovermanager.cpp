@@ -44,6 +44,8 @@
 #include <QImage>
 #include <QPixmap>
 #include <QPainter>
+#include <QPoint>
+#include <QRect>
 #include <QNetworkAccessManager>
 #include <QShortcut>
 #include <QSplitter>
@@ -52,6 +54,7 @@
 #include <QListWidget>
 #include <QMessageBox>
 #include <QProgressBar>
+#include <QScrollBar>
 #include <QPushButton>
 #include <QToolButton>
 #include <QKeySequence>
@@ -85,12 +88,14 @@
 using std::stable_sort;
 
 const char *AlbumCoverManager::kSettingsGroup = "CoverManager";
+const int AlbumCoverManager::kPrioritizeDelayMsec = 100;
 
 AlbumCoverManager::AlbumCoverManager(Application *app, CollectionBackend *collection_backend, QWidget *parent, QNetworkAccessManager *network)
     : QMainWindow(parent),
       ui_(new Ui_CoverManager),
       app_(app),
       album_cover_choice_controller_(new AlbumCoverChoiceController(this)),
+      prioritize_timer_(new QTimer(this)),
       cover_fetcher_(new AlbumCoverFetcher(app_->cover_providers(), this, network)),
       cover_searcher_(nullptr),
       cover_export_(nullptr),
@@ -119,6 +124,8 @@ AlbumCoverManager::AlbumCoverManager(Application *app, CollectionBackend *collec
 
   album_cover_choice_controller_->SetApplication(app_);
 
+  cover_loader_options_.use_thumbnail_cache_ = true;
+
   // Get a square version of noalbumart.png
   QImage nocover(":/pictures/noalbumart.png");
   nocover = nocover.scaled(120, 120, Qt::KeepAspectRatio, Qt::SmoothTransformation);
@@ -210,6 +217,10 @@ void AlbumCoverManager::Init() {
   connect(ui_->albums, SIGNAL(doubleClicked(QModelIndex)), SLOT(AlbumDoubleClicked(QModelIndex)));
   connect(ui_->action_add_to_playlist, SIGNAL(triggered()), SLOT(AddSelectedToPlaylist()));
   connect(ui_->action_load, SIGNAL(triggered()), SLOT(LoadSelectedToPlaylist()));
+  prioritize_timer_->setSingleShot(true);
+  prioritize_timer_->setInterval(kPrioritizeDelayMsec);
+  connect(prioritize_timer_, SIGNAL(timeout()), SLOT(PrioritizeVisibleCovers()));
+  connect(ui_->albums->verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(PrioritizeVisibleCoversLater()));
 
   // Restore settings
   QSettings s;
@@ -356,11 +367,51 @@ void AlbumCoverManager::ArtistChanged(QListWidgetItem *current) {
       quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, info.art_automatic, info.art_manual, info.first_url.toLocalFile());
       item->setData(Role_PathAutomatic, info.art_automatic);
       item->setData(Role_PathManual, info.art_manual);
+      item->setData(Role_LoadingTaskId, id);
       cover_loading_tasks_[id] = item;
     }
   }
 
   UpdateFilter();
+  PrioritizeVisibleCovers();
+
+}
+
+void AlbumCoverManager::PrioritizeVisibleCoversLater() {
+
+  if (!prioritize_timer_->isActive()) prioritize_timer_->start();
+
+}
+
+void AlbumCoverManager::PrioritizeVisibleCovers() {
+
+  if (cover_loading_tasks_.isEmpty()) return;
+
+  // Load the covers that are on screen before the ones that have been scrolled past.
+  // The items are laid out in row order, so only the rows between the corners of the viewport need to be looked at.
+  // A corner can be in the spacing between items, so the top one is tried again just below it, and without the bottom one the loop stops at the first item below the viewport.
+  const QRect viewport_rect = ui_->albums->viewport()->rect();
+  const int step = ui_->albums->spacing() * 2 + 1;
+  QModelIndex first_index = ui_->albums->indexAt(viewport_rect.topLeft() + QPoint(step, 0));
+  if (!first_index.isValid()) first_index = ui_->albums->indexAt(viewport_rect.topLeft() + QPoint(step, step));
+  const QModelIndex last_index = ui_->albums->indexAt(viewport_rect.bottomRight());
+  const int first_row = first_index.isValid() ? first_index.row() : 0;
+  const int last_row = last_index.isValid() ? last_index.row() : ui_->albums->count() - 1;
+
+  QSet<quint64> ids;
+  for (int row = first_row ; row <= last_row ; ++row) {
+    QListWidgetItem *item = ui_->albums->item(row);
+    if (item->isHidden()) continue;
+
+    const QRect rect = ui_->albums->visualItemRect(item);
+    if (rect.top() > viewport_rect.bottom()) break;
+    if (!rect.intersects(viewport_rect)) continue;
+
+    const QVariant id = item->data(Role_LoadingTaskId);
+    if (id.isValid() && cover_loading_tasks_.value(id.toULongLong()) == item) ids.insert(id.toULongLong());
+  }
+
+  if (!ids.isEmpty()) app_->album_cover_loader()->PrioritizeTasks(ids);
 
 }
 
@@ -369,6 +420,7 @@ void AlbumCoverManager::CoverImageLoaded(quint64 id, const QImage &image) {
   if (!cover_loading_tasks_.contains(id)) return;
 
   QListWidgetItem *item = cover_loading_tasks_.take(id);
+  item->setData(Role_LoadingTaskId, QVariant());
 
   if (image.isNull()) return;
 
@@ -598,6 +650,7 @@ void AlbumCoverManager::UpdateCoverInList(QListWidgetItem *item, const QString &
 
   quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, QString(), cover);
   item->setData(Role_PathManual, cover);
+  item->setData(Role_LoadingTaskId, id);
   cover_loading_tasks_[id] = item;
 
 }
@@ -797,6 +850,7 @@ void AlbumCoverManager::SaveAndSetCover(QListWidgetItem *item, const QImage &ima
   // Update the icon in our list
   quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, QString(), path);
   item->setData(Role_PathManual, path);
+  item->setData(Role_LoadingTaskId, id);
   cover_loading_tasks_[id] = item;
 
 }
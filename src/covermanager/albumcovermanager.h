@@ -42,6 +42,7 @@
 #include <QMimeData>
 #include <QProgressBar>
 #include <QPushButton>
+#include <QTimer>
 #include <QtEvents>
 
 #include "core/song.h"
@@ -66,6 +67,7 @@ class AlbumCoverManager : public QMainWindow {
   ~AlbumCoverManager();
 
   static const char *kSettingsGroup;
+  static const int kPrioritizeDelayMsec;
 
   CollectionBackend *backend() const;
   QIcon no_cover_icon() const { return no_cover_icon_; }
@@ -93,6 +95,9 @@ class AlbumCoverManager : public QMainWindow {
  private slots:
   void ArtistChanged(QListWidgetItem *current);
   void CoverImageLoaded(quint64 id, const QImage &image);
+  // Throttles PrioritizeVisibleCovers() while the albums are scrolled.
+  void PrioritizeVisibleCoversLater();
+  void PrioritizeVisibleCovers();
   void UpdateFilter();
   void FetchAlbumCovers();
   void ExportCovers();
@@ -130,7 +135,9 @@ class AlbumCoverManager : public QMainWindow {
     Role_AlbumName,
     Role_PathAutomatic,
     Role_PathManual,
-    Role_FirstUrl
+    Role_FirstUrl,
+    // ID of the cover loader task loading the item's icon, if any.
+    Role_LoadingTaskId
   };
 
   enum HideCovers {
@@ -165,6 +172,7 @@ class AlbumCoverManager : public QMainWindow {
 
   AlbumCoverLoaderOptions cover_loader_options_;
   QMap<quint64, QListWidgetItem*> cover_loading_tasks_;
+  QTimer *prioritize_timer_;
 
   AlbumCoverFetcher *cover_fetcher_;
   QMap<quint64, QListWidgetItem*> cover_fetching_tasks_;
@@ -0,0 +1,145 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QCache>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QIODevice>
+#include <QBuffer>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+#include <QUrl>
+#include <QImage>
+#include <QNetworkDiskCache>
+#include <QNetworkCacheMetaData>
+
+#include "albumcoverloaderoptions.h"
+#include "albumcoverthumbnailcache.h"
+
+const int AlbumCoverThumbnailCache::kMemoryCacheSize = 20000000;  // ~20MB
+const qint64 AlbumCoverThumbnailCache::kDiskCacheSize = 200000000;  // ~200MB
+
+AlbumCoverThumbnailCache::AlbumCoverThumbnailCache()
+    : memory_cache_(kMemoryCacheSize),
+      disk_cache_(new QNetworkDiskCache) {
+
+  disk_cache_->setCacheDirectory(CacheDir());
+  disk_cache_->setMaximumCacheSize(kDiskCacheSize);
+
+}
+
+AlbumCoverThumbnailCache::~AlbumCoverThumbnailCache() {
+  delete disk_cache_;
+}
+
+QString AlbumCoverThumbnailCache::CacheDir() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/albumcoverthumbnails";
+}
+
+QUrl AlbumCoverThumbnailCache::CacheKey(const AlbumCoverLoaderOptions &options, const QString &filename) {
+
+  const QFileInfo info(filename);
+  if (!info.exists()) return QUrl();
+
+  QByteArray key;
+  key.append(info.absoluteFilePath().toUtf8());
+  key.append('\0');
+  key.append(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+  key.append('\0');
+  key.append(QByteArray::number(options.desired_height_));
+  key.append(options.pad_output_image_ ? "p" : "s");
+
+  return QUrl("thumbnail:" + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+
+}
+
+QImage AlbumCoverThumbnailCache::Find(const AlbumCoverLoaderOptions &options, const QString &filename) {
+
+  const QUrl key = CacheKey(options, filename);
+  if (key.isEmpty()) return QImage();
+
+  // The lock only covers the caches, the PNG is decoded without it so other loader threads aren't held up.
+  std::unique_ptr<QIODevice> device;
+  {
+    QMutexLocker l(&mutex_);
+    if (QImage *image = memory_cache_.object(key)) {
+      return *image;
+    }
+    device.reset(disk_cache_->data(key));
+  }
+  if (!device) return QImage();
+
+  QImage image;
+  if (!image.load(device.get(), "PNG")) return QImage();
+
+  QMutexLocker l(&mutex_);
+  memory_cache_.insert(key, new QImage(image), image.byteCount());
+
+  return image;
+
+}
+
+void AlbumCoverThumbnailCache::Insert(const AlbumCoverLoaderOptions &options, const QString &filename, const QImage &thumbnail) {
+
+  if (thumbnail.isNull()) return;
+
+  const QUrl key = CacheKey(options, filename);
+  if (key.isEmpty()) return;
+
+  // Encode before taking the lock, only the cache operations need it.
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  const bool encoded = thumbnail.save(&buffer, "PNG");
+
+  QMutexLocker l(&mutex_);
+
+  memory_cache_.insert(key, new QImage(thumbnail), thumbnail.byteCount());
+
+  if (!encoded) return;
+
+  QNetworkCacheMetaData metadata;
+  metadata.setUrl(key);
+  metadata.setSaveToDisk(true);
+  QIODevice *device = disk_cache_->prepare(metadata);
+  if (!device) return;
+  if (device->write(data) == data.size()) {
+    disk_cache_->insert(device);
+  }
+  else {
+    disk_cache_->remove(key);
+  }
+
+}
+
+void AlbumCoverThumbnailCache::Clear() {
+
+  QMutexLocker l(&mutex_);
+  memory_cache_.clear();
+  disk_cache_->clear();
+
+}
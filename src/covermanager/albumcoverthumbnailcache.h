@@ -0,0 +1,64 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ALBUMCOVERTHUMBNAILCACHE_H
+#define ALBUMCOVERTHUMBNAILCACHE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QCache>
+#include <QString>
+#include <QUrl>
+#include <QImage>
+
+#include "albumcoverloaderoptions.h"
+
+class QNetworkDiskCache;
+
+// Keeps scaled album covers so views showing many small covers don't have to decode the full size images again.
+// The first tier is an in-memory LRU limited by the size of the images in bytes, the second a disk cache that survives restarts.
+// Entries are keyed on the image path, its modification time and the output options, so a changed image never matches an old thumbnail.
+// All functions are thread-safe.
+class AlbumCoverThumbnailCache {
+ public:
+  AlbumCoverThumbnailCache();
+  ~AlbumCoverThumbnailCache();
+
+  static const int kMemoryCacheSize;
+  static const qint64 kDiskCacheSize;
+
+  static QString CacheDir();
+
+  // Returns a null image if there is no thumbnail for the file.
+  QImage Find(const AlbumCoverLoaderOptions &options, const QString &filename);
+  void Insert(const AlbumCoverLoaderOptions &options, const QString &filename, const QImage &thumbnail);
+
+  void Clear();
+
+ private:
+  static QUrl CacheKey(const AlbumCoverLoaderOptions &options, const QString &filename);
+
+  QMutex mutex_;
+  QCache<QUrl, QImage> memory_cache_;
+  QNetworkDiskCache *disk_cache_;
+};
+
+#endif  // ALBUMCOVERTHUMBNAILCACHE_H
@@ -60,6 +60,7 @@
 #include "dialogs/organiseerrordialog.h"
 #include "collection/collectiondirectorymodel.h"
 #include "collection/collectionmodel.h"
+#include "collection/collectionsortmodel.h"
 #include "collection/collectionview.h"
 #include "connecteddevice.h"
 #include "devicelister.h"
@@ -308,10 +309,8 @@ void DeviceView::DeviceConnected(int row) {
 
   QModelIndex sort_idx = sort_model_->mapFromSource(app_->device_manager()->index(row));
 
-  QSortFilterProxyModel *sort_model = new QSortFilterProxyModel(device->model());
+  CollectionSortModel *sort_model = new CollectionSortModel(device->model());
   sort_model->setSourceModel(device->model());
-  sort_model->setSortRole(CollectionModel::Role_SortText);
-  sort_model->setDynamicSortFilter(true);
   sort_model->sort(0);
   merged_model_->AddSubModel(sort_idx, sort_model);
 
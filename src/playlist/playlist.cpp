@@ -27,7 +27,8 @@
 #include <functional>
 #include <iterator>
 #include <type_traits>
-#include <unordered_map>
+#include <numeric>
+#include <vector>
 #include <stdbool.h>
 
 #include <QtGlobal>
@@ -35,35 +36,38 @@
 #include <QCoreApplication>
 #include <QtAlgorithms>
 #include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QFuture>
 #include <QIODevice>
 #include <QDataStream>
 #include <QBuffer>
 #include <QFile>
 #include <QList>
+#include <QHash>
 #include <QMap>
 #include <QSet>
 #include <QMimeData>
 #include <QVariant>
 #include <QString>
 #include <QStringList>
+#include <QCollator>
+#include <QThread>
 #include <QUrl>
 #include <QColor>
 #include <QFont>
 #include <QBrush>
-#include <QLinkedList>
 #include <QUndoStack>
 #include <QUndoCommand>
 #include <QModelIndex>
 #include <QAbstractListModel>
 #include <QPersistentModelIndex>
 #include <QMutableListIterator>
-#include <QMutableLinkedListIterator>
 #include <QFlags>
 #include <QSettings>
 
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/fileexistencechecker.h"
 #include "core/logging.h"
 #include "core/mimedata.h"
 #include "core/tagreaderclient.h"
@@ -77,6 +81,7 @@
 #include "playlistview.h"
 #include "playlistsequence.h"
 #include "playlistbackend.h"
+#include "playlistduplicatefinder.h"
 #include "playlistfilter.h"
 #include "playlistitemmimedata.h"
 #include "playlistundocommands.h"
@@ -93,7 +98,6 @@
 using std::placeholders::_1;
 using std::placeholders::_2;
 using std::shared_ptr;
-using std::unordered_map;
 using std::sort;
 using std::stable_sort;
 using std::greater;
@@ -114,8 +118,10 @@ const char *Playlist::kSettingsGroup = "Playlist";
 const char *Playlist::kPathType = "path_type";
 const char *Playlist::kWriteMetadata = "write_metadata";
 
-const int Playlist::kUndoStackSize = 20;
-const int Playlist::kUndoItemLimit = 500;
+const int Playlist::kUndoStackSize = 50;
+const int Playlist::kUndoItemLimit = 200000;
+const int Playlist::kRestoreChunkSize = 1000;
+const int Playlist::kSortMinRangeSize = 10000;
 
 Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, CollectionBackend *collection, int id, const QString &special_type, bool favorite, QObject *parent)
     : QAbstractListModel(parent),
@@ -134,15 +140,16 @@ Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, Collecti
       ignore_sorting_(false),
       undo_stack_(new QUndoStack(this)),
       special_type_(special_type),
-      cancel_restore_(false) {
+      cancel_restore_(false),
+      restore_state_(RestoreState_NotStarted),
+      save_after_restore_(false),
+      pending_item_saves_(0) {
 
   undo_stack_->setUndoLimit(kUndoStackSize);
 
   connect(this, SIGNAL(rowsInserted(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
   connect(this, SIGNAL(rowsRemoved(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
 
-  Restore();
-
   proxy_->setSourceModel(this);
   queue_->setSourceModel(this);
 
@@ -257,6 +264,51 @@ bool Playlist::set_column_value(Song &song, Playlist::Column column, const QVari
 
 }
 
+QVariant Playlist::column_value(const Song &song, int column, int role) {
+
+  // Don't forget to change MakeSortKey when adding new columns
+  switch (column) {
+    case Column_Title:              return song.PrettyTitle();
+    case Column_Artist:             return song.artist();
+    case Column_Album:              return song.album();
+    case Column_Length:             return song.length_nanosec();
+    case Column_Track:              return song.track();
+    case Column_Disc:               return song.disc();
+    case Column_Year:               return song.year();
+    case Column_OriginalYear:       return song.effective_originalyear();
+    case Column_Genre:              return song.genre();
+    case Column_AlbumArtist:        return song.playlist_albumartist();
+    case Column_Composer:           return song.composer();
+    case Column_Performer:          return song.performer();
+    case Column_Grouping:           return song.grouping();
+
+    case Column_PlayCount:          return song.playcount();
+    case Column_SkipCount:          return song.skipcount();
+    case Column_LastPlayed:         return song.lastplayed();
+
+    case Column_Samplerate:         return song.samplerate();
+    case Column_Bitdepth:           return song.bitdepth();
+    case Column_Bitrate:            return song.bitrate();
+
+    case Column_Filename:           return song.url();
+    case Column_BaseFilename:       return song.basefilename();
+    case Column_Filesize:           return song.filesize();
+    case Column_Filetype:           return song.filetype();
+    case Column_DateModified:       return song.mtime();
+    case Column_DateCreated:        return song.ctime();
+
+    case Column_Comment:
+      if (role == Qt::DisplayRole)  return song.comment().simplified();
+      return song.comment();
+
+    case Column_Source:             return song.source();
+
+  }
+
+  return QVariant();
+
+}
+
 QVariant Playlist::data(const QModelIndex &index, int role) const {
 
   switch (role) {
@@ -274,51 +326,8 @@ QVariant Playlist::data(const QModelIndex &index, int role) const {
 
     case Qt::EditRole:
     case Qt::ToolTipRole:
-    case Qt::DisplayRole: {
-      PlaylistItemPtr item = items_[index.row()];
-      Song song = item->Metadata();
-
-      // Don't forget to change Playlist::CompareItems when adding new columns
-      switch (index.column()) {
-        case Column_Title:              return song.PrettyTitle();
-        case Column_Artist:             return song.artist();
-        case Column_Album:              return song.album();
-        case Column_Length:             return song.length_nanosec();
-        case Column_Track:              return song.track();
-        case Column_Disc:               return song.disc();
-        case Column_Year:               return song.year();
-        case Column_OriginalYear:       return song.effective_originalyear();
-        case Column_Genre:              return song.genre();
-        case Column_AlbumArtist:        return song.playlist_albumartist();
-        case Column_Composer:           return song.composer();
-        case Column_Performer:          return song.performer();
-        case Column_Grouping:           return song.grouping();
-
-        case Column_PlayCount:          return song.playcount();
-        case Column_SkipCount:          return song.skipcount();
-        case Column_LastPlayed:         return song.lastplayed();
-
-        case Column_Samplerate:         return song.samplerate();
-        case Column_Bitdepth:           return song.bitdepth();
-        case Column_Bitrate:            return song.bitrate();
-
-        case Column_Filename:           return song.url();
-        case Column_BaseFilename:       return song.basefilename();
-        case Column_Filesize:           return song.filesize();
-        case Column_Filetype:           return song.filetype();
-        case Column_DateModified:       return song.mtime();
-        case Column_DateCreated:        return song.ctime();
-
-        case Column_Comment:
-          if (role == Qt::DisplayRole)  return song.comment().simplified();
-          return song.comment();
-
-        case Column_Source:             return song.source();
-
-      }
-
-      return QVariant();
-    }
+    case Qt::DisplayRole:
+      return column_value(items_[index.row()]->Metadata(), index.column(), role);
 
     case Qt::TextAlignmentRole:
       return QVariant(column_alignments_.value(index.column(), (Qt::AlignLeft | Qt::AlignVCenter)));
@@ -370,6 +379,7 @@ bool Playlist::setData(const QModelIndex &index, const QVariant &value, int role
 
   if (!set_column_value(song, (Column)index.column(), value)) return false;
 
+    ++pending_item_saves_;
     TagReaderReply *reply = TagReaderClient::Instance()->SaveFile( song.url().toLocalFile(), song);
     NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(SongSaveComplete(TagReaderReply*, QPersistentModelIndex)), reply, QPersistentModelIndex(index));
 
@@ -379,10 +389,12 @@ bool Playlist::setData(const QModelIndex &index, const QVariant &value, int role
 
 void Playlist::SongSaveComplete(TagReaderReply *reply, const QPersistentModelIndex &index) {
 
+  bool reloading = false;
   if (reply->is_successful() && index.isValid()) {
     if (reply->message().save_file_response().success()) {
       QFuture<void> future = item_at(index.row())->BackgroundReload();
       NewClosure(future, this, SLOT(ItemReloadComplete(QPersistentModelIndex)), index);
+      reloading = true;
     }
     else {
       emit Error(tr("An error occurred writing metadata to '%1'").arg(QString::fromStdString(reply->request_message().save_file_request().filename())));
@@ -390,15 +402,27 @@ void Playlist::SongSaveComplete(TagReaderReply *reply, const QPersistentModelInd
   }
 
   reply->deleteLater();
+  if (!reloading) ItemSaveFinished();
 
 }
 
 void Playlist::ItemReloadComplete(const QPersistentModelIndex &index) {
 
   if (index.isValid()) {
+    changed_items_ << item_at(index.row());
     emit dataChanged(index, index);
     emit EditingFinished(index);
   }
+  ItemSaveFinished();
+
+}
+
+void Playlist::ItemSaveFinished() {
+
+  // Editing several rows at once reloads each of them, save the playlist once for all of them.
+  if (--pending_item_saves_ > 0) return;
+  pending_item_saves_ = 0;
+  if (!changed_items_.isEmpty()) Save();
 
 }
 
@@ -425,6 +449,26 @@ bool Playlist::FilterContainsVirtualIndex(int i) const {
   return proxy_->filterAcceptsRow(virtual_items_[i], QModelIndex());
 }
 
+int Playlist::VirtualIndexOf(int row) const {
+
+  // The reverse lookup is rebuilt the first time it's needed after virtual_items_ changed, so a batch of changes only costs one pass over the list.
+  if (virtual_index_of_row_.count() != virtual_items_.count()) {
+    virtual_index_of_row_.fill(-1, virtual_items_.count());
+    for (int i = 0; i < virtual_items_.count(); ++i) {
+      const int item_row = virtual_items_[i];
+      if (item_row >= 0 && item_row < virtual_index_of_row_.count()) virtual_index_of_row_[item_row] = i;
+    }
+  }
+
+  if (row < 0 || row >= virtual_index_of_row_.count()) return -1;
+  return virtual_index_of_row_[row];
+
+}
+
+void Playlist::VirtualItemsChanged() {
+  virtual_index_of_row_.clear();
+}
+
 int Playlist::NextVirtualIndex(int i, bool ignore_repeat_track) const {
 
   PlaylistSequence::RepeatMode repeat_mode = playlist_sequence_->repeat_mode();
@@ -593,12 +637,13 @@ void Playlist::set_current_row(int i, bool is_stopping) {
     ReshuffleIndices();
 
     // Bring the one we've been asked to play to the start of the list
-    virtual_items_.takeAt(virtual_items_.indexOf(i));
+    virtual_items_.takeAt(VirtualIndexOf(i));
     virtual_items_.prepend(i);
+    VirtualItemsChanged();
     current_virtual_index_ = 0;
   }
   else if (is_shuffled_) {
-    current_virtual_index_ = virtual_items_.indexOf(i);
+    current_virtual_index_ = VirtualIndexOf(i);
   }
   else {
     current_virtual_index_ = i;
@@ -786,7 +831,7 @@ void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
       changePersistentIndex(pidx, index(pidx.row() + d, pidx.column(), QModelIndex()));
     }
   }
-  current_virtual_index_ = virtual_items_.indexOf(current_row());
+  current_virtual_index_ = VirtualIndexOf(current_row());
 
   layoutChanged();
   Save();
@@ -836,7 +881,7 @@ void Playlist::MoveItemsWithoutUndo(int start, const QList<int> &dest_rows) {
       changePersistentIndex(pidx, index(pidx.row() + d, pidx.column(), QModelIndex()));
     }
   }
-  current_virtual_index_ = virtual_items_.indexOf(current_row());
+  current_virtual_index_ = VirtualIndexOf(current_row());
 
   layoutChanged();
   Save();
@@ -848,6 +893,15 @@ void Playlist::InsertItems(const PlaylistItemList &itemsIn, int pos, bool play_n
   if (itemsIn.isEmpty())
     return;
 
+  // Make sure the new items end up after the saved ones.
+  RestoreIfNeeded();
+
+  // Rows past the restored ones aren't there yet.
+  if (restore_state_ == RestoreState_Restoring && pos > RestorePosition()) {
+    pending_inserts_ << PendingInsert(itemsIn, pos, play_now, enqueue, enqueue_next);
+    return;
+  }
+
   PlaylistItemList items = itemsIn;
 
   // exercise vetoes
@@ -910,10 +964,22 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, int pos, bo
   const int end = start + items.count() - 1;
 
   beginInsertRows(QModelIndex(), start, end);
+
+  // Insert all items at once, inserting them one by one in the middle of a large playlist is quadratic.
+  if (start == items_.count()) {
+    items_.append(items);
+  }
+  else {
+    items_ = items_.mid(0, start) + items + items_.mid(start);
+  }
+  virtual_items_.reserve(items_.count());
+  for (int i = virtual_items_.count(); i < items_.count(); ++i) {
+    virtual_items_ << i;
+  }
+  VirtualItemsChanged();
+
   for (int i = start; i <= end; ++i) {
     PlaylistItemPtr item = items[i - start];
-    items_.insert(i, item);
-    virtual_items_ << virtual_items_.count();
 
     if (item->source() == Song::Source_Collection) {
       int id = item->Metadata().id();
@@ -980,52 +1046,47 @@ void Playlist::InsertInternetItems(InternetService *service, const SongList &son
 void Playlist::UpdateItems(const SongList &songs) {
 
   qLog(Debug) << "Updating playlist with new tracks' info";
-  // We first convert our songs list into a linked list (a 'real' list), because removals are faster with QLinkedList.
-  // Next, we walk through the list of playlist's items then the list of songs
-  // we want to update: if an item corresponds to the song (we rely on URL for this), we update the item with the new metadata,
-  // then we remove song from our list because we will not need to check it again.
+  // Songs arrive in batches while their tags are read, so index them by URL first to only look up each item once.
+  // If an item corresponds to a song (we rely on URL for this), we update the item with the new metadata,
+  // then we remove the song from the index because we will not need to check it again.
   // And we also update undo actions.
-  QLinkedList<Song> songs_list;
-  for (const Song &song : songs) songs_list.append(song);
-
-  for (int i = 0; i < items_.size(); i++) {
-    // Update current items list
-    QMutableLinkedListIterator<Song> it(songs_list);
-    while (it.hasNext()) {
-      const Song &song = it.next();
-      PlaylistItemPtr &item = items_[i];
-      if (item->Metadata().url() == song.url() &&
-          (
-           item->Metadata().source() == Song::Source_Unknown ||
-           item->Metadata().filetype() == Song::FileType_Unknown ||
-           // Stream may change and may need to be updated too
-           item->Metadata().source() == Song::Source_Stream ||
-           item->Metadata().source() == Song::Source_Tidal ||
-           // And CD tracks as well (tags are loaded in a second step)
-           item->Metadata().source() == Song::Source_CDDA
-          )
+  QHash<QUrl, QList<Song>> songs_by_url;
+  for (const Song &song : songs) songs_by_url[song.url()] << song;
+
+  for (int i = 0; i < items_.size() && !songs_by_url.isEmpty(); i++) {
+    PlaylistItemPtr &item = items_[i];
+    QHash<QUrl, QList<Song>>::iterator it = songs_by_url.find(item->Metadata().url());
+    if (it == songs_by_url.end()) continue;
+    if (
+        item->Metadata().source() == Song::Source_Unknown ||
+        item->Metadata().filetype() == Song::FileType_Unknown ||
+        // Stream may change and may need to be updated too
+        item->Metadata().source() == Song::Source_Stream ||
+        item->Metadata().source() == Song::Source_Tidal ||
+        // And CD tracks as well (tags are loaded in a second step)
+        item->Metadata().source() == Song::Source_CDDA
        ) {
-        PlaylistItemPtr new_item;
-        if (song.is_collection_song()) {
-          new_item = PlaylistItemPtr(new CollectionPlaylistItem(song));
-          collection_items_by_id_.insertMulti(song.id(), new_item);
-        }
-        else {
-          new_item = PlaylistItemPtr(new SongPlaylistItem(song));
-        }
-        items_[i] = new_item;
-        emit dataChanged(index(i, 0), index(i, ColumnCount - 1));
-        // Also update undo actions
-        for (int i = 0; i < undo_stack_->count(); i++) {
-          QUndoCommand *undo_action = const_cast<QUndoCommand*>(undo_stack_->command(i));
-          PlaylistUndoCommands::InsertItems *undo_action_insert = dynamic_cast<PlaylistUndoCommands::InsertItems*>(undo_action);
-          if (undo_action_insert) {
-            bool found_and_updated = undo_action_insert->UpdateItem(new_item);
-            if (found_and_updated) break;
-          }
+      const Song song = it.value().takeFirst();
+      if (it.value().isEmpty()) songs_by_url.erase(it);
+
+      PlaylistItemPtr new_item;
+      if (song.is_collection_song()) {
+        new_item = PlaylistItemPtr(new CollectionPlaylistItem(song));
+        collection_items_by_id_.insertMulti(song.id(), new_item);
+      }
+      else {
+        new_item = PlaylistItemPtr(new SongPlaylistItem(song));
+      }
+      items_[i] = new_item;
+      emit dataChanged(index(i, 0), index(i, ColumnCount - 1));
+      // Also update undo actions
+      for (int i = 0; i < undo_stack_->count(); i++) {
+        QUndoCommand *undo_action = const_cast<QUndoCommand*>(undo_stack_->command(i));
+        PlaylistUndoCommands::InsertItems *undo_action_insert = dynamic_cast<PlaylistUndoCommands::InsertItems*>(undo_action);
+        if (undo_action_insert) {
+          bool found_and_updated = undo_action_insert->UpdateItem(new_item);
+          if (found_and_updated) break;
         }
-        it.remove();
-        break;
       }
     }
   }
@@ -1070,68 +1131,6 @@ QMimeData *Playlist::mimeData(const QModelIndexList &indexes) const {
 
 }
 
-bool Playlist::CompareItems(int column, Qt::SortOrder order, shared_ptr<PlaylistItem> _a, shared_ptr<PlaylistItem> _b) {
-
-  shared_ptr<PlaylistItem> a = order == Qt::AscendingOrder ? _a : _b;
-  shared_ptr<PlaylistItem> b = order == Qt::AscendingOrder ? _b : _a;
-
-#define cmp(field) return a->Metadata().field() < b->Metadata().field()
-#define strcmp(field) return QString::localeAwareCompare(a->Metadata().field().toLower(), b->Metadata().field().toLower()) < 0;
-
-  switch (column) {
-
-    case Column_Title:        strcmp(title);
-    case Column_Artist:       strcmp(artist);
-    case Column_Album:        strcmp(album);
-    case Column_Length:       cmp(length_nanosec);
-    case Column_Track:        cmp(track);
-    case Column_Disc:         cmp(disc);
-    case Column_Year:         cmp(year);
-    case Column_OriginalYear: cmp(originalyear);
-    case Column_Genre:        strcmp(genre);
-    case Column_AlbumArtist:  strcmp(playlist_albumartist);
-    case Column_Composer:     strcmp(composer);
-    case Column_Performer:    strcmp(performer);
-    case Column_Grouping:     strcmp(grouping);
-
-    case Column_PlayCount:    cmp(playcount);
-    case Column_SkipCount:    cmp(skipcount);
-    case Column_LastPlayed:   cmp(lastplayed);
-
-    case Column_Bitrate:      cmp(bitrate);
-    case Column_Samplerate:   cmp(samplerate);
-    case Column_Bitdepth:     cmp(bitdepth);
-    case Column_Filename:
-      return (QString::localeAwareCompare(a->Url().path().toLower(), b->Url().path().toLower()) < 0);
-    case Column_BaseFilename: cmp(basefilename);
-    case Column_Filesize:     cmp(filesize);
-    case Column_Filetype:     cmp(filetype);
-    case Column_DateModified: cmp(mtime);
-    case Column_DateCreated:  cmp(ctime);
-
-    case Column_Comment:      strcmp(comment);
-    case Column_Source:       cmp(source);
-  }
-
-#undef cmp
-#undef strcmp
-
-  return false;
-
-}
-
-bool Playlist::ComparePathDepths(Qt::SortOrder order, shared_ptr<PlaylistItem> _a, shared_ptr<PlaylistItem> _b) {
-
-  shared_ptr<PlaylistItem> a = order == Qt::AscendingOrder ? _a : _b;
-  shared_ptr<PlaylistItem> b = order == Qt::AscendingOrder ? _b : _a;
-
-  int a_dir_level = a->Url().path().count('/');
-  int b_dir_level = b->Url().path().count('/');
-
-  return a_dir_level < b_dir_level;
-
-}
-
 QString Playlist::column_name(Column column) {
 
   switch (column) {
@@ -1189,29 +1188,189 @@ QString Playlist::abbreviated_column_name(Column column) {
 
 }
 
-void Playlist::sort(int column, Qt::SortOrder order) {
+namespace {
 
-  if (ignore_sorting_) return;
+// Key of one item for Playlist::sort(), extracted once up front so the comparisons don't need to go through the items.
+// Keys are compared by major, then by text, then by the minor values.
+struct SortKey {
+  explicit SortKey(const QCollatorSortKey &_text, qint64 _major = 0, qint64 minor0 = 0, qint64 minor1 = 0) : major(_major), text(_text) {
+    minor[0] = minor0;
+    minor[1] = minor1;
+  }
+
+  qint64 major;
+  QCollatorSortKey text;
+  qint64 minor[2];
+};
+typedef std::vector<SortKey> SortKeyList;
 
-  PlaylistItemList new_items(items_);
-  PlaylistItemList::iterator begin = new_items.begin();
+// Don't forget to change this when adding new columns
+SortKey MakeSortKey(const QCollator &collator, const QCollatorSortKey &no_text, int column, const PlaylistItemPtr &item) {
 
-  if (column == Column_Album) {
+  const Song song = item->Metadata();
+
+#define number_key(field) return SortKey(no_text, song.field())
+#define text_key(field) return SortKey(collator.sortKey(song.field().toLower()))
+
+  switch (column) {
+
+    case Playlist::Column_Title:        text_key(title);
+    case Playlist::Column_Artist:       text_key(artist);
     // When sorting by album, also take into account discs and tracks.
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Track, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Disc, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Album, order, _1, _2));
+    case Playlist::Column_Album:        return SortKey(collator.sortKey(song.album().toLower()), 0, song.disc(), song.track());
+    case Playlist::Column_Length:       number_key(length_nanosec);
+    case Playlist::Column_Track:        number_key(track);
+    case Playlist::Column_Disc:         number_key(disc);
+    case Playlist::Column_Year:         number_key(year);
+    case Playlist::Column_OriginalYear: number_key(originalyear);
+    case Playlist::Column_Genre:        text_key(genre);
+    case Playlist::Column_AlbumArtist:  text_key(playlist_albumartist);
+    case Playlist::Column_Composer:     text_key(composer);
+    case Playlist::Column_Performer:    text_key(performer);
+    case Playlist::Column_Grouping:     text_key(grouping);
+
+    case Playlist::Column_PlayCount:    number_key(playcount);
+    case Playlist::Column_SkipCount:    number_key(skipcount);
+    case Playlist::Column_LastPlayed:   number_key(lastplayed);
+
+    case Playlist::Column_Bitrate:      number_key(bitrate);
+    case Playlist::Column_Samplerate:   number_key(samplerate);
+    case Playlist::Column_Bitdepth:     number_key(bitdepth);
+    case Playlist::Column_Filename: {
+      // When sorting by full paths we also expect a hierarchical order. This gives a breadth-first ordering of paths.
+      const QString path = item->Url().path();
+      return SortKey(collator.sortKey(path.toLower()), path.count('/'));
+    }
+    case Playlist::Column_BaseFilename: text_key(basefilename);
+    case Playlist::Column_Filesize:     number_key(filesize);
+    case Playlist::Column_Filetype:     number_key(filetype);
+    case Playlist::Column_DateModified: number_key(mtime);
+    case Playlist::Column_DateCreated:  number_key(ctime);
+
+    case Playlist::Column_Comment:      text_key(comment);
+    case Playlist::Column_Source:       number_key(source);
   }
-  else if (column == Column_Filename) {
-    // When sorting by full paths we also expect a hierarchical order. This returns a breath-first ordering of paths.
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Filename, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::ComparePathDepths, order, _1, _2));
+
+#undef number_key
+#undef text_key
+
+  return SortKey(no_text);
+
+}
+
+class SortKeyLessThan {
+ public:
+  SortKeyLessThan(const SortKeyList &keys, Qt::SortOrder order) : keys_(keys), order_(order) {}
+
+  bool operator()(int a, int b) const {
+
+    const SortKey &left = keys_[order_ == Qt::AscendingOrder ? a : b];
+    const SortKey &right = keys_[order_ == Qt::AscendingOrder ? b : a];
+
+    if (left.major != right.major) return left.major < right.major;
+    const int text = left.text.compare(right.text);
+    if (text != 0) return text < 0;
+    if (left.minor[0] != right.minor[0]) return left.minor[0] < right.minor[0];
+    return left.minor[1] < right.minor[1];
+
   }
-  else {
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, column, order, _1, _2));
+
+ private:
+  const SortKeyList &keys_;
+  Qt::SortOrder order_;
+};
+
+// A range of the playlist handled by one thread, used both for extracting the keys and for sorting and merging the rows.
+struct SortRange {
+  SortRange() : items(nullptr), column(0), rows(nullptr), less_than(nullptr), begin(0), middle(0), end(0) {}
+
+  const PlaylistItemList *items;
+  int column;
+  SortKeyList keys;
+
+  std::vector<int> *rows;
+  const SortKeyLessThan *less_than;
+  int begin;
+  int middle;
+  int end;
+};
+
+void ExtractSortKeys(SortRange &range) {
+
+  // QCollator isn't thread-safe, so every range needs its own.
+  QCollator collator;
+  const QCollatorSortKey no_text = collator.sortKey(QString());
+
+  range.keys.reserve(range.end - range.begin);
+  for (int i = range.begin ; i < range.end ; ++i) {
+    range.keys.push_back(MakeSortKey(collator, no_text, range.column, range.items->at(i)));
+  }
+
+}
+
+void SortRows(SortRange &range) {
+  std::stable_sort(range.rows->begin() + range.begin, range.rows->begin() + range.end, *range.less_than);
+}
+
+void MergeRows(SortRange &range) {
+  std::inplace_merge(range.rows->begin() + range.begin, range.rows->begin() + range.middle, range.rows->begin() + range.end, *range.less_than);
+}
+
+}
+
+void Playlist::sort(int column, Qt::SortOrder order) {
+
+  if (ignore_sorting_) return;
+
+  // Every thread gets one range of the playlist.  The keys are extracted and the ranges are sorted in parallel, then merged pairwise.
+  const int count = items_.count();
+  const int range_count = qBound(1, count / kSortMinRangeSize, QThread::idealThreadCount());
+  const int range_size = qMax(1, (count + range_count - 1) / range_count);
+
+  QList<SortRange> ranges;
+  for (int begin = 0 ; begin < count ; begin += range_size) {
+    SortRange range;
+    range.items = &items_;
+    range.column = column;
+    range.begin = begin;
+    range.end = qMin(begin + range_size, count);
+    ranges << range;
+  }
+  QtConcurrent::blockingMap(ranges, &ExtractSortKeys);
+
+  SortKeyList keys;
+  keys.reserve(count);
+  for (const SortRange &range : ranges) {
+    keys.insert(keys.end(), range.keys.begin(), range.keys.end());
+  }
+
+  const SortKeyLessThan less_than(keys, order);
+  std::vector<int> rows(count);
+  std::iota(rows.begin(), rows.end(), 0);
+
+  for (SortRange &range : ranges) {
+    range.keys.clear();
+    range.rows = &rows;
+    range.less_than = &less_than;
+  }
+  QtConcurrent::blockingMap(ranges, &SortRows);
+
+  // std::inplace_merge keeps the rows from the first range first, so the sort stays stable.
+  for (int width = range_size ; width < count ; width *= 2) {
+    QList<SortRange> merges;
+    for (int begin = 0 ; begin + width < count ; begin += 2 * width) {
+      SortRange merge;
+      merge.rows = &rows;
+      merge.less_than = &less_than;
+      merge.begin = begin;
+      merge.middle = begin + width;
+      merge.end = qMin(begin + 2 * width, count);
+      merges << merge;
+    }
+    QtConcurrent::blockingMap(merges, &MergeRows);
   }
 
-  undo_stack_->push(new PlaylistUndoCommands::SortItems(this, column, order, new_items));
+  undo_stack_->push(new PlaylistUndoCommands::SortItems(this, column, order, QVector<int>::fromStdVector(rows)));
 
   ReshuffleIndices();
 
@@ -1224,7 +1383,8 @@ void Playlist::ReOrderWithoutUndo(const PlaylistItemList &new_items) {
   PlaylistItemList old_items = items_;
   items_ = new_items;
 
-  QMap<const PlaylistItem*, int> new_rows;
+  QHash<const PlaylistItem*, int> new_rows;
+  new_rows.reserve(new_items.count());
   for (int i = 0; i < new_items.length(); ++i) {
     new_rows[new_items[i].get()] = i;
   }
@@ -1258,15 +1418,67 @@ void Playlist::SetCurrentIsPaused(bool paused) {
 }
 
 void Playlist::Save() const {
+
   if (!backend_ || is_loading_) return;
 
-  backend_->SavePlaylistAsync(id_, items_, last_played_row());
+  // Saving a partly restored playlist would lose the rest of it.
+  if (restore_state_ == RestoreState_Restoring) {
+    save_after_restore_ = true;
+    return;
+  }
+  if (restore_state_ == RestoreState_NotStarted) return;
+
+  backend_->SavePlaylistAsync(id_, items_, last_played_row(), changed_items_);
+  changed_items_.clear();
+
+}
+
+void Playlist::RestoreIfNeeded() {
+
+  if (restore_state_ == RestoreState_NotStarted) Restore();
+
+}
+
+bool Playlist::Unload() {
+
+  if (!backend_ || restore_state_ != RestoreState_Restored || is_loading_) return false;
+  // The queue and the current item only live in memory.
+  if (!queue_->is_empty() || current_item_index_.isValid()) return false;
+
+  Save();
+  backend_->ForgetSavedRowsAsync(id_);
+
+  beginResetModel();
+  items_.clear();
+  virtual_items_.clear();
+  VirtualItemsChanged();
+  collection_items_by_id_.clear();
+  generated_items_.clear();
+  changed_items_.clear();
+  current_virtual_index_ = -1;
+  endResetModel();
+
+  // The undo commands hold on to the items too.
+  undo_stack_->clear();
+
+  restore_state_ = RestoreState_NotStarted;
+
+  return true;
 
 }
 
-//namespace {
-//typedef QFutureWatcher<QList<PlaylistItemPtr>> PlaylistItemFutureWatcher;
-//}
+PlaylistBackend::PlaylistSummary Playlist::GetSummary() const {
+
+  if (restore_state_ != RestoreState_Restored && backend_) {
+    return restore_summary_;
+  }
+
+  PlaylistBackend::PlaylistSummary summary;
+  summary.count = items_.count();
+  summary.length_nanosec = GetTotalLength();
+  return summary;
+
+}
 
 void Playlist::Restore() {
 
@@ -1274,19 +1486,52 @@ void Playlist::Restore() {
 
   items_.clear();
   virtual_items_.clear();
+  VirtualItemsChanged();
   collection_items_by_id_.clear();
+  generated_items_.clear();
+  changed_items_.clear();
 
   cancel_restore_ = false;
-  QFuture<QList<PlaylistItemPtr>> future = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
-  NewClosure(future, this, SLOT(ItemsLoaded(QFuture<PlaylistItemList>)), future);
+  restore_state_ = RestoreState_Restoring;
+  restore_anchor_ = QPersistentModelIndex();
+  pending_inserts_.clear();
+  save_after_restore_ = false;
+  restore_summary_ = PlaylistBackend::PlaylistSummary();
+
+  QFuture<PlaylistBackend::PlaylistSummary> future = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistSummary, id_);
+  NewClosure(future, this, SLOT(SummaryLoaded(QFuture<PlaylistBackend::PlaylistSummary>)), future);
+
+  RestoreChunk(PlaylistBackend::ItemsCursor());
+
+}
+
+void Playlist::SummaryLoaded(QFuture<PlaylistBackend::PlaylistSummary> future) {
+
+  // Not needed anymore if the restore already finished.
+  if (cancel_restore_ || restore_state_ != RestoreState_Restoring) return;
+
+  restore_summary_ = future.result();
+  emit SummaryChanged();
+
+}
+
+void Playlist::RestoreChunk(const PlaylistBackend::ItemsCursor &cursor) {
+
+  QFuture<PlaylistBackend::ItemsChunk> future = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItemsChunk, id_, cursor, kRestoreChunkSize);
+  NewClosure(future, this, SLOT(ItemsLoaded(QFuture<PlaylistBackend::ItemsChunk>)), future);
 
 }
 
-void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
+void Playlist::ItemsLoaded(QFuture<PlaylistBackend::ItemsChunk> future) {
 
   if (cancel_restore_) return;
 
-  PlaylistItemList items = future.result();
+  PlaylistBackend::ItemsChunk chunk = future.result();
+
+  // Read the next chunk while this one is being inserted.
+  if (!chunk.at_end) RestoreChunk(chunk.next);
+
+  PlaylistItemList items = chunk.items;
 
   // Backend returns empty elements for collection items which it couldn't match (because they got deleted); we don't need those
   QMutableListIterator<PlaylistItemPtr> it(items);
@@ -1298,15 +1543,45 @@ void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
     }
   }
 
-  is_loading_ = true;
-  InsertItems(items, 0);
-  is_loading_ = false;
+  // Items added while restoring go after the restored ones.
+  if (!items.isEmpty()) {
+    const int start = RestorePosition();
+    is_loading_ = true;
+    InsertItemsWithoutUndo(items, start);
+    is_loading_ = false;
+    restore_anchor_ = index(start + items.count() - 1, 0);
+  }
+
+  if (chunk.at_end) FinishRestore();
+
+}
+
+int Playlist::RestorePosition() const {
+  return restore_anchor_.isValid() ? restore_anchor_.row() + 1 : 0;
+}
+
+void Playlist::FinishRestore() {
+
+  restore_state_ = RestoreState_Restored;
 
   PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
 
   // The newly loaded list of items might be shorter than it was before so look out for a bad last_played index
   last_played_item_index_ = p.last_played == -1 || p.last_played >= rowCount() ? QModelIndex() : index(p.last_played);
 
+  if (save_after_restore_) {
+    save_after_restore_ = false;
+    Save();
+  }
+
+  restore_anchor_ = QPersistentModelIndex();
+  const QList<PendingInsert> pending_inserts = pending_inserts_;
+  pending_inserts_.clear();
+  for (const PendingInsert &insert : pending_inserts) {
+    // The saved playlist might have been shorter than the position.
+    InsertItems(insert.items, qMin(insert.pos, items_.count()), insert.play_now, insert.enqueue, insert.enqueue_next);
+  }
+
   emit RestoreFinished();
 
   QSettings s;
@@ -1314,7 +1589,7 @@ void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
 
   // Should we gray out deleted songs asynchronously on startup?
   if (s.value("greyoutdeleted", false).toBool()) {
-    QtConcurrent::run(this, &Playlist::InvalidateDeletedSongs);
+    InvalidateDeletedSongs();
   }
 
 }
@@ -1398,14 +1673,19 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(int row, int count) {
   if (row < 0 || row >= items_.size() || row + count > items_.size()) {
     return PlaylistItemList();
   }
+
+  // If the last restored item is removed, the next chunk of the restore goes after the item before it.
+  if (restore_state_ == RestoreState_Restoring && restore_anchor_.isValid() && restore_anchor_.row() >= row && restore_anchor_.row() < row + count) {
+    restore_anchor_ = row > 0 ? QPersistentModelIndex(index(row - 1, 0)) : QPersistentModelIndex();
+  }
+
   beginRemoveRows(QModelIndex(), row, row + count - 1);
 
   // Remove items
-  PlaylistItemList ret;
-  for (int i = 0; i < count; ++i) {
-    PlaylistItemPtr item(items_.takeAt(row));
-    ret << item;
-
+  PlaylistItemList ret = items_.mid(row, count);
+  items_.erase(items_.begin() + row, items_.begin() + row + count);
+  for (PlaylistItemPtr item : ret) {
+    generated_items_.remove(item.get());
     if (item->source() == Song::Source_Collection) {
       int id = item->Metadata().id();
       if (id != -1) {
@@ -1416,26 +1696,20 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(int row, int count) {
 
   endRemoveRows();
 
-  QList<int>::iterator it = virtual_items_.begin();
-  int i = 0;
-  while (it != virtual_items_.end()) {
-    if (*it >= items_.count())
-      it = virtual_items_.erase(it);
-    else
-      ++it;
-    ++i;
-  }
+  const int item_count = items_.count();
+  virtual_items_.erase(std::remove_if(virtual_items_.begin(), virtual_items_.end(), [item_count](int i) { return i >= item_count; }), virtual_items_.end());
+  VirtualItemsChanged();
 
   // Reset current_virtual_index_
   if (current_row() == -1)
     if (row - 1 > 0 && row - 1 < items_.size()) {
-      current_virtual_index_ = virtual_items_.indexOf(row - 1);
+      current_virtual_index_ = VirtualIndexOf(row - 1);
     }
     else {
       current_virtual_index_ = -1;
     }
   else
-    current_virtual_index_ = virtual_items_.indexOf(current_row());
+    current_virtual_index_ = VirtualIndexOf(current_row());
 
   Save();
   return ret;
@@ -1521,8 +1795,14 @@ Song Playlist::current_item_metadata() const {
 
 void Playlist::Clear() {
 
+  const bool was_restoring = restore_state_ == RestoreState_Restoring;
+
   // If loading songs from session restore async, don't insert them
   cancel_restore_ = true;
+  restore_state_ = RestoreState_Restored;
+  save_after_restore_ = false;
+  restore_anchor_ = QPersistentModelIndex();
+  pending_inserts_.clear();
 
   const int count = items_.count();
 
@@ -1537,6 +1817,9 @@ void Playlist::Clear() {
 
   Save();
 
+  // Whoever waits for the restore won't get it from FinishRestore() anymore.
+  if (was_restoring) emit RestoreFinished();
+
 }
 
 void Playlist::RemoveItemsNotInQueue() {
@@ -1575,6 +1858,7 @@ void Playlist::ReloadItems(const QList<int> &rows) {
     PlaylistItemPtr item = item_at(row);
 
     item->Reload();
+    changed_items_ << item;
 
     if (row == current_row()) {
       InformOfCurrentSongChange();
@@ -1604,18 +1888,19 @@ void Playlist::SongInsertVetoListenerDestroyed() {
 
 void Playlist::Shuffle() {
 
-  PlaylistItemList new_items(items_);
-
-  int begin = 0;
-
   const int count = items_.count();
-  for (int i = begin; i < count; ++i) {
+  QVector<int> new_rows(count);
+  for (int i = 0; i < count; ++i) {
+    new_rows[i] = i;
+  }
+
+  for (int i = 0; i < count; ++i) {
     int new_pos = i + (rand() % (count - i));
 
-    std::swap(new_items[i], new_items[new_pos]);
+    std::swap(new_rows[i], new_rows[new_pos]);
   }
 
-  undo_stack_->push(new PlaylistUndoCommands::ShuffleItems(this, new_items));
+  undo_stack_->push(new PlaylistUndoCommands::ShuffleItems(this, new_rows));
 
 }
 
@@ -1640,8 +1925,9 @@ void Playlist::ReshuffleIndices() {
   if (playlist_sequence_->shuffle_mode() == PlaylistSequence::Shuffle_Off) {
     // No shuffling - sort the virtual item list normally.
     std::sort(virtual_items_.begin(), virtual_items_.end());
+    VirtualItemsChanged();
     if (current_row() != -1)
-      current_virtual_index_ = virtual_items_.indexOf(current_row());
+      current_virtual_index_ = VirtualIndexOf(current_row());
     return;
   }
 
@@ -1700,6 +1986,8 @@ void Playlist::ReshuffleIndices() {
     }
   }
 
+  VirtualItemsChanged();
+
 }
 
 void Playlist::set_sequence(PlaylistSequence *v) {
@@ -1772,6 +2060,120 @@ void Playlist::ItemChanged(PlaylistItemPtr item) {
   }
 }
 
+void Playlist::UpdateCollectionItems(const SongList &songs) {
+
+  if (collection_items_by_id_.isEmpty()) return;
+
+  // Find the items of the changed songs through the ID index.
+  QSet<const PlaylistItem*> changed;
+  for (const Song &song : songs) {
+    QMultiHash<int, PlaylistItemPtr>::iterator it = collection_items_by_id_.find(song.id());
+    for (; it != collection_items_by_id_.end() && it.key() == song.id(); ++it) {
+      PlaylistItemPtr item = it.value();
+      if (item->Metadata().directory_id() != song.directory_id()) continue;
+      static_cast<CollectionPlaylistItem*>(item.get())->SetMetadata(song);
+      changed << item.get();
+    }
+  }
+
+  EmitItemsChanged(changed);
+
+}
+
+void Playlist::EmitItemsChanged(const QSet<const PlaylistItem*> &items) {
+
+  if (items.isEmpty()) return;
+
+  // Find all their rows in one pass.
+  int first = -1;
+  for (int row = 0; row <= items_.count(); ++row) {
+    const bool is_changed = row < items_.count() && items.contains(items_[row].get());
+    if (is_changed && first == -1) {
+      first = row;
+    }
+    else if (!is_changed && first != -1) {
+      emit dataChanged(index(first, 0), index(row - 1, ColumnCount - 1));
+      first = -1;
+    }
+  }
+
+}
+
+void Playlist::LoadCollectionItemsAsync(const PlaylistItemList &items) {
+
+  if (!backend_) return;
+
+  PlaylistItemList unloaded;
+  QList<int> ids;
+  for (PlaylistItemPtr item : items) {
+    if (!item->IsReferenceOnly() || !item->Metadata().url().isEmpty()) continue;
+    unloaded << item;
+    ids << item->Metadata().id();
+  }
+  if (unloaded.isEmpty()) return;
+
+  QFuture<SongList> future = QtConcurrent::run(backend_, &PlaylistBackend::GetCollectionSongs, ids);
+  NewClosure(future, this, SLOT(CollectionItemsLoaded(QFuture<SongList>, PlaylistItemList)), future, unloaded);
+
+}
+
+void Playlist::CollectionItemsLoaded(QFuture<SongList> future, const PlaylistItemList &items) {
+
+  QHash<int, Song> songs;
+  for (const Song &song : future.result()) {
+    songs.insert(song.id(), song);
+  }
+
+  // The items can have been removed again in the meantime, they are updated anyway because the undo stack might put them back.
+  // Songs that are no longer in the collection keep an empty song, like when the playlist is restored.
+  QSet<const PlaylistItem*> changed;
+  for (PlaylistItemPtr item : items) {
+    const int id = item->Metadata().id();
+    if (!songs.contains(id)) continue;
+    static_cast<CollectionPlaylistItem*>(item.get())->SetMetadata(songs[id]);
+    changed << item.get();
+  }
+
+  EmitItemsChanged(changed);
+
+}
+
+void Playlist::UpdateGeneratedItems(const SongList &added, const QSet<int> &removed_ids) {
+
+  QList<int> removed_rows;
+  if (!removed_ids.isEmpty() && !generated_items_.isEmpty()) {
+    for (int row = 0; row < items_.count(); ++row) {
+      const PlaylistItemPtr &item = items_[row];
+      if (generated_items_.contains(item.get()) && removed_ids.contains(item->Metadata().id())) removed_rows << row;
+    }
+  }
+
+  if (!removed_rows.isEmpty()) {
+    RemoveItemsWithoutUndo(removed_rows);
+    // The rows in the undo commands don't match anymore.  Appending is fine, the undo commands only use rows before the end.
+    undo_stack_->clear();
+  }
+
+  if (!added.isEmpty()) {
+    PlaylistItemList items;
+    for (const Song &song : added) {
+      PlaylistItemPtr item(new CollectionPlaylistItem(song));
+      generated_items_ << item.get();
+      items << item;
+    }
+    InsertItemsWithoutUndo(items, -1);
+  }
+
+}
+
+void Playlist::MarkCollectionItemsGenerated() {
+
+  for (const PlaylistItemPtr &item : items_) {
+    if (item->source() == Song::Source_Collection) generated_items_ << item.get();
+  }
+
+}
+
 void Playlist::InformOfCurrentSongChange() {
 
   emit dataChanged(index(current_item_index_.row(), 0), index(current_item_index_.row(), ColumnCount - 1));
@@ -1786,24 +2188,32 @@ void Playlist::InformOfCurrentSongChange() {
 
 void Playlist::InvalidateDeletedSongs() {
 
-  QList<int> invalidated_rows;
+  PlaylistItemList items;
+  for (PlaylistItemPtr item : items_) {
+    if (!item->Metadata().is_stream()) items << item;
+  }
+
+  CheckFilesExist(items, SLOT(InvalidateDeletedSongsFinished(QFuture<QSet<QString>>, PlaylistItemList)));
+
+}
+
+void Playlist::InvalidateDeletedSongsFinished(QFuture<QSet<QString>> future, const PlaylistItemList &items) {
 
+  const QHash<const PlaylistItem*, bool> exists = FilesExist(future.result(), items);
+
+  QList<int> invalidated_rows;
   for (int row = 0; row < items_.count(); ++row) {
     PlaylistItemPtr item = items_[row];
-    Song song = item->Metadata();
-
-    if (!song.is_stream()) {
-      bool exists = QFile::exists(song.url().toLocalFile());
+    if (!exists.contains(item.get())) continue;
 
-      if (!exists && !item->HasForegroundColor(kInvalidSongPriority)) {
-        // gray out the song if it's not there
-        item->SetForegroundColor(kInvalidSongPriority, kInvalidSongColor);
-        invalidated_rows.append(row);
-      }
-      else if (exists && item->HasForegroundColor(kInvalidSongPriority)) {
-        item->RemoveForegroundColor(kInvalidSongPriority);
-        invalidated_rows.append(row);
-      }
+    if (!exists[item.get()] && !item->HasForegroundColor(kInvalidSongPriority)) {
+      // gray out the song if it's not there
+      item->SetForegroundColor(kInvalidSongPriority, kInvalidSongColor);
+      invalidated_rows.append(row);
+    }
+    else if (exists[item.get()] && item->HasForegroundColor(kInvalidSongPriority)) {
+      item->RemoveForegroundColor(kInvalidSongPriority);
+      invalidated_rows.append(row);
     }
   }
 
@@ -1812,13 +2222,20 @@ void Playlist::InvalidateDeletedSongs() {
 }
 
 void Playlist::RemoveDeletedSongs() {
-  QList<int> rows_to_remove;
 
-  for (int row = 0; row < items_.count(); ++row) {
-    PlaylistItemPtr item = items_[row];
-    Song song = item->Metadata();
+  CheckFilesExist(items_, SLOT(RemoveDeletedSongsFinished(QFuture<QSet<QString>>, PlaylistItemList)));
 
-    if (!QFile::exists(song.url().toLocalFile())) {
+}
+
+void Playlist::RemoveDeletedSongsFinished(QFuture<QSet<QString>> future, const PlaylistItemList &items) {
+
+  const QHash<const PlaylistItem*, bool> exists = FilesExist(future.result(), items);
+
+  // Items can have been moved or removed while the files were checked.
+  QList<int> rows_to_remove;
+  for (int row = 0; row < items_.count(); ++row) {
+    const PlaylistItem *item = items_[row].get();
+    if (exists.contains(item) && !exists[item]) {
       rows_to_remove.append(row);
     }
   }
@@ -1827,67 +2244,44 @@ void Playlist::RemoveDeletedSongs() {
 
 }
 
-struct SongSimilarHash {
-  long operator() (const Song &song) const {
-    return HashSimilar(song);
-  }
-};
+void Playlist::CheckFilesExist(const PlaylistItemList &items, const char *slot) {
 
-struct SongSimilarEqual {
-  long operator()(const Song &song1, const Song &song2) const {
-    return song1.IsSimilar(song2);
+  QStringList filenames;
+  for (PlaylistItemPtr item : items) {
+    filenames << item->Metadata().url().toLocalFile();
   }
-};
 
-void Playlist::RemoveDuplicateSongs() {
+  QFuture<QSet<QString>> future = QtConcurrent::run(FileExistenceChecker::Instance(), &FileExistenceChecker::Check, filenames);
+  NewClosure(future, this, slot, future, items);
 
-  QList<int> rows_to_remove;
-  unordered_map<Song, int, SongSimilarHash, SongSimilarEqual> unique_songs;
-
-  for (int row = 0; row < items_.count(); ++row) {
-    PlaylistItemPtr item = items_[row];
-    const Song &song = item->Metadata();
+}
 
-    bool found_duplicate = false;
+QHash<const PlaylistItem*, bool> Playlist::FilesExist(const QSet<QString> &existing, const PlaylistItemList &items) {
 
-    auto uniq_song_it = unique_songs.find(song);
-    if (uniq_song_it != unique_songs.end()) {
-      const Song &uniq_song = uniq_song_it->first;
+  QHash<const PlaylistItem*, bool> ret;
+  for (PlaylistItemPtr item : items) {
+    ret.insert(item.get(), existing.contains(item->Metadata().url().toLocalFile()));
+  }
+  return ret;
 
-      if (song.bitrate() > uniq_song.bitrate()) {
-        rows_to_remove.append(unique_songs[uniq_song]);
-        unique_songs.erase(uniq_song);
-        unique_songs.insert(std::make_pair(song, row));
-      }
-      else {
-        rows_to_remove.append(row);
-      }
-      found_duplicate = true;
-    }
+}
 
-    if (!found_duplicate) {
-      unique_songs.insert(std::make_pair(song, row));
-    }
-  }
+void Playlist::RemoveDuplicateSongs() {
 
+  QList<int> rows_to_remove = PlaylistDuplicateFinder::Find(QList<SongList>() << GetAllSongs(), PlaylistDuplicateFinder::Mode_Similar, nullptr, -1).first();
   removeRows(rows_to_remove);
 
 }
 
 void Playlist::RemoveUnavailableSongs() {
 
-  QList<int> rows_to_remove;
-  for (int row = 0; row < items_.count(); ++row) {
-    PlaylistItemPtr item = items_[row];
-    const Song &song = item->Metadata();
-
-    // Check only local files
-    if (song.url().isLocalFile() && !QFile::exists(song.url().toLocalFile())) {
-      rows_to_remove.append(row);
-    }
+  // Check only local files
+  PlaylistItemList items;
+  for (PlaylistItemPtr item : items_) {
+    if (item->Metadata().url().isLocalFile()) items << item;
   }
 
-  removeRows(rows_to_remove);
+  CheckFilesExist(items, SLOT(RemoveDeletedSongsFinished(QFuture<QSet<QString>>, PlaylistItemList)));
 
 }
 
@@ -28,7 +28,10 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QFuture>
+#include <QHash>
+#include <QSet>
 #include <QList>
+#include <QVector>
 #include <QMap>
 #include <QMetaType>
 #include <QMimeData>
@@ -48,9 +51,9 @@
 #include "core/tagreaderclient.h"
 #include "playlistitem.h"
 #include "playlistsequence.h"
+#include "playlistbackend.h"
 
 class CollectionBackend;
-class PlaylistBackend;
 class PlaylistFilter;
 class Queue;
 class TaskManager;
@@ -159,18 +162,31 @@ class Playlist : public QAbstractListModel {
 
   static const int kUndoStackSize;
   static const int kUndoItemLimit;
-
-  static bool CompareItems(int column, Qt::SortOrder order, PlaylistItemPtr a, PlaylistItemPtr b);
+  static const int kRestoreChunkSize;
+  static const int kSortMinRangeSize;
 
   static QString column_name(Column column);
   static QString abbreviated_column_name(Column column);
 
   static bool column_is_editable(Playlist::Column column);
   static bool set_column_value(Song &song, Column column, const QVariant &value);
+  // The value shown in the given column for the song, as returned by data().
+  static QVariant column_value(const Song &song, int column, int role = Qt::DisplayRole);
 
   // Persistence
   void Save() const;
+  // Loads the items from the database in chunks, showing each chunk as soon as it has been read.
   void Restore();
+  // Playlists are restored the first time they are shown or changed.
+  void RestoreIfNeeded();
+  bool is_restored() const { return restore_state_ == RestoreState_Restored; }
+  bool is_restoring() const { return restore_state_ == RestoreState_Restoring; }
+  // Saves the playlist and releases its items, so it's restored again the next time it's needed.
+  // Returns false if the playlist can't be unloaded right now, for example because it has queued items.
+  bool Unload();
+  // The number of items and their total length.  While the playlist is being restored, this is read from the database in the background once per restore,
+  // and is empty until SummaryChanged() is emitted.
+  PlaylistBackend::PlaylistSummary GetSummary() const;
 
   // Accessors
   QSortFilterProxyModel *proxy() const;
@@ -229,6 +245,7 @@ class Playlist : public QAbstractListModel {
   // This returns true if this playlist had current item when the method was invoked.
   bool ApplyValidityOnCurrentSong(const QUrl &url, bool valid);
   // Grays out and reloads all deleted songs in all playlists. Also, "ungreys" those songs which were once deleted but now got restored somehow.
+  // The files are checked in the background with FileExistenceChecker.
   void InvalidateDeletedSongs();
   // Removes from the playlist all local files that don't exist anymore.
   void RemoveDeletedSongs();
@@ -256,8 +273,6 @@ class Playlist : public QAbstractListModel {
   void sort(int column, Qt::SortOrder order);
   bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
 
-  static bool ComparePathDepths(Qt::SortOrder, PlaylistItemPtr, PlaylistItemPtr);
-
  public slots:
   void set_current_row(int index, bool is_stopping = false);
   void Paused();
@@ -269,6 +284,13 @@ class Playlist : public QAbstractListModel {
   void SetStreamMetadata(const QUrl &url, const Song &song);
   void ItemChanged(PlaylistItemPtr item);
   void UpdateItems(const SongList &songs);
+  // Updates the collection items of songs that changed in the collection, emitting one dataChanged() for each run of changed rows.
+  void UpdateCollectionItems(const SongList &songs);
+  // Appends the added collection songs and removes the generated items with the removed IDs, used to keep smart playlists up to date.
+  // Items added by the user are left alone.  This operation is not undoable, and clears the undo stack if rows were removed.
+  void UpdateGeneratedItems(const SongList &added, const QSet<int> &removed_ids);
+  // Treats all collection items as generated, for restored smart playlists since it isn't saved which items were added by the user.
+  void MarkCollectionItemsGenerated();
 
   void Clear();
   void RemoveDuplicateSongs();
@@ -298,11 +320,18 @@ signals:
   // Signals that the queue has changed, meaning that the remaining queued items should update their position.
   void QueueChanged();
 
+  // The summary of the whole playlist was read while restoring it.
+  void SummaryChanged();
+
 private:
   void SetCurrentIsPaused(bool paused);
   int NextVirtualIndex(int i, bool ignore_repeat_track) const;
   int PreviousVirtualIndex(int i, bool ignore_repeat_track) const;
   bool FilterContainsVirtualIndex(int i) const;
+  // Returns the position of the row in virtual_items_, or -1.
+  int VirtualIndexOf(int row) const;
+  // Must be called after changing virtual_items_.
+  void VirtualItemsChanged();
 
   template <typename T>
   void InsertSongItems(const SongList &songs, int pos, bool play_now, bool enqueue, bool enqueue_next = false);
@@ -314,6 +343,10 @@ private:
   void MoveItemWithoutUndo(int source, int dest);
   void MoveItemsWithoutUndo(int start, const QList<int> &dest_rows);
   void ReOrderWithoutUndo(const PlaylistItemList &new_items);
+  // Reads the songs of collection items that were put back by undo with only their ID in the background, and fills in their metadata.
+  void LoadCollectionItemsAsync(const PlaylistItemList &items);
+  // Emits dataChanged for the rows of the items, one signal per run of adjacent rows.
+  void EmitItemsChanged(const QSet<const PlaylistItem*> &items);
 
   void RemoveItemsNotInQueue();
 
@@ -327,10 +360,32 @@ private:
   void QueueLayoutChanged();
   void SongSaveComplete(TagReaderReply *reply, const QPersistentModelIndex &index);
   void ItemReloadComplete(const QPersistentModelIndex &index);
-  void ItemsLoaded(QFuture<PlaylistItemList> future);
+  void ItemsLoaded(QFuture<PlaylistBackend::ItemsChunk> future);
+  void SummaryLoaded(QFuture<PlaylistBackend::PlaylistSummary> future);
+  void CollectionItemsLoaded(QFuture<SongList> future, const PlaylistItemList &items);
+  void InvalidateDeletedSongsFinished(QFuture<QSet<QString>> future, const PlaylistItemList &items);
+  void RemoveDeletedSongsFinished(QFuture<QSet<QString>> future, const PlaylistItemList &items);
   void SongInsertVetoListenerDestroyed();
 
 private:
+  // Called when the tags of an edited item were written and reloaded, or that failed.
+  void ItemSaveFinished();
+  // Checks in the background which of the items' files exist and calls slot with the result and the items.
+  void CheckFilesExist(const PlaylistItemList &items, const char *slot);
+  // Returns for each of the items whether its file was found.
+  static QHash<const PlaylistItem*, bool> FilesExist(const QSet<QString> &existing, const PlaylistItemList &items);
+
+  enum RestoreState {
+    RestoreState_NotStarted,
+    RestoreState_Restoring,
+    RestoreState_Restored
+  };
+
+  void RestoreChunk(const PlaylistBackend::ItemsCursor &cursor);
+  void FinishRestore();
+  // The row the next chunk of the restore is inserted at.
+  int RestorePosition() const;
+
   bool is_loading_;
   PlaylistFilter *proxy_;
   Queue *queue_;
@@ -347,8 +402,14 @@ private:
   PlaylistItemList items_;
   // Contains the indices into items_ in the order that they will be played.
   QList<int> virtual_items_;
+  // Position of each row in virtual_items_, see VirtualIndexOf().
+  mutable QVector<int> virtual_index_of_row_;
   // A map of collection ID to playlist item - for fast lookups when collection items change.
-  QMultiMap<int, PlaylistItemPtr> collection_items_by_id_;
+  QMultiHash<int, PlaylistItemPtr> collection_items_by_id_;
+  // Items added by UpdateGeneratedItems(), these are the only ones it removes again.
+  QSet<const PlaylistItem*> generated_items_;
+  // Items whose metadata changed in place since the last save.  Inserted, removed and moved items are found by the backend.
+  mutable PlaylistItemList changed_items_;
 
   QPersistentModelIndex current_item_index_;
   QPersistentModelIndex last_played_item_index_;
@@ -373,6 +434,26 @@ private:
 
   // Cancel async restore if songs are already replaced
   bool cancel_restore_;
+  RestoreState restore_state_;
+  // The last item inserted so far by the restore, the next chunk is inserted after it.  It's a persistent index so it follows the item when the user edits the playlist while it's being restored.
+  QPersistentModelIndex restore_anchor_;
+  // Items inserted at a position while the playlist was being restored, beyond the rows restored so far.  The position refers to the whole playlist, so they're inserted when the restore has finished.
+  struct PendingInsert {
+    PendingInsert(const PlaylistItemList &_items, int _pos, bool _play_now, bool _enqueue, bool _enqueue_next)
+        : items(_items), pos(_pos), play_now(_play_now), enqueue(_enqueue), enqueue_next(_enqueue_next) {}
+    PlaylistItemList items;
+    int pos;
+    bool play_now;
+    bool enqueue;
+    bool enqueue_next;
+  };
+  QList<PendingInsert> pending_inserts_;
+  // The size of the whole playlist, shown while it's being restored.
+  PlaylistBackend::PlaylistSummary restore_summary_;
+  // Saves are held back until the restore has finished.
+  mutable bool save_after_restore_;
+  // Number of edited items whose tags are still being written or reloaded, the playlist is saved once they are all done.
+  int pending_item_saves_;
 };
 
 // QDataStream& operator <<(QDataStream&, const Playlist*);
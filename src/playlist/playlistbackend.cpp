@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <functional>
+#include <algorithm>
 
 #include <QObject>
 #include <QMutex>
@@ -29,6 +30,8 @@
 #include <QByteArray>
 #include <QHash>
 #include <QList>
+#include <QSet>
+#include <QVector>
 #include <QVariant>
 #include <QString>
 #include <QStringBuilder>
@@ -45,6 +48,7 @@
 #include "core/song.h"
 #include "collection/collectionbackend.h"
 #include "collection/sqlrow.h"
+#include "collection/collectionplaylistitem.h"
 #include "playlistitem.h"
 #include "songplaylistitem.h"
 #include "playlistbackend.h"
@@ -53,7 +57,9 @@
 using std::placeholders::_1;
 using std::shared_ptr;
 
-const int PlaylistBackend::kSongTableJoins = 2;
+const int PlaylistBackend::kCollectionLookupChunkSize = 5000;
+const qint64 PlaylistBackend::kPositionStep = 1024;
+const double PlaylistBackend::kFullSaveThreshold = 0.5;
 
 PlaylistBackend::PlaylistBackend(Application *app, QObject *parent)
     : QObject(parent), app_(app), db_(app_->database()) {}
@@ -90,7 +96,7 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(GetPlaylistsFlags fl
   }
 
   QSqlQuery q(db);
-  q.prepare("SELECT ROWID, name, last_played, special_type, ui_path, is_favorite FROM playlists " + condition + " ORDER BY ui_order");
+  q.prepare("SELECT ROWID, name, last_played, special_type, ui_path, is_favorite, smart_playlist_data FROM playlists " + condition + " ORDER BY ui_order");
   q.exec();
   if (db_->CheckErrors(q)) return ret;
 
@@ -102,6 +108,7 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(GetPlaylistsFlags fl
     p.special_type = q.value(3).toString();
     p.ui_path = q.value(4).toString();
     p.favorite = q.value(5).toBool();
+    p.smart_playlist_data = q.value(6).toByteArray();
     ret << p;
   }
 
@@ -115,7 +122,7 @@ PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(db);
-  q.prepare("SELECT ROWID, name, last_played, special_type, ui_path, is_favorite FROM playlists WHERE ROWID=:id");
+  q.prepare("SELECT ROWID, name, last_played, special_type, ui_path, is_favorite, smart_playlist_data FROM playlists WHERE ROWID=:id");
 
   q.bindValue(":id", id);
   q.exec();
@@ -130,75 +137,170 @@ PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
   p.special_type = q.value(3).toString();
   p.ui_path = q.value(4).toString();
   p.favorite = q.value(5).toBool();
+  p.smart_playlist_data = q.value(6).toByteArray();
 
   return p;
 
 }
 
-QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist) {
+QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist, const ItemsCursor &cursor, int count) {
 
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QString query = "SELECT songs.ROWID, " + Song::JoinSpec("songs") +
+  QString query = "SELECT p.ROWID, " + Song::JoinSpec("p") +
                   ","
-                  "       p.ROWID, " +
-                  Song::JoinSpec("p") +
-                  ","
-                  "       p.type"
+                  "       p.type, p.collection_id, p.position"
                   " FROM playlist_items AS p"
-                  " LEFT JOIN songs"
-                  "    ON p.collection_id = songs.ROWID"
                   " WHERE p.playlist = :playlist";
+  if (cursor.id != -1) {
+    query += " AND (p.position > :position1 OR (p.position = :position2 AND p.ROWID > :id))";
+  }
+  query += " ORDER BY p.position, p.ROWID";
+  if (count != -1) {
+    query += " LIMIT " + QString::number(count);
+  }
+
   QSqlQuery q(db);
   // Forward iterations only may be faster
   q.setForwardOnly(true);
   q.prepare(query);
   q.bindValue(":playlist", playlist);
+  if (cursor.id != -1) {
+    q.bindValue(":position1", cursor.position);
+    q.bindValue(":position2", cursor.position);
+    q.bindValue(":id", cursor.id);
+  }
   q.exec();
 
   return q;
 
 }
 
-QList<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
+int PlaylistBackend::ReadPlaylistItems(int playlist, const ItemsCursor &cursor, int count, PlaylistItemList *items, SavedItemList *saved) {
 
-  QSqlQuery q = GetPlaylistRows(playlist);
+  QSqlQuery q = GetPlaylistRows(playlist, cursor, count);
   // Note that as this only accesses the query, not the db, we don't need the mutex.
-  if (db_->CheckErrors(q)) return QList<PlaylistItemPtr>();
+  if (db_->CheckErrors(q)) return -1;
+
+  // The type, collection ID and position come after the playlist_items columns.
+  const int id_column = 0;
+  const int collection_id_column = Song::kColumns.count() + 2;
+  const int position_column = Song::kColumns.count() + 3;
+
+  QList<SqlRow> rows;
+  QList<int> collection_ids;
+  while (q.next()) {
+    SqlRow row(q);
+    const int collection_id = row.value(collection_id_column).isNull() ? -1 : row.value(collection_id_column).toInt();
+    if (collection_id > 0) collection_ids << collection_id;
+    rows << row;
+  }
+
+  // Collection items only store a reference to the song, look all of them up at once.
+  QHash<int, Song> collection_songs;
+  for (const Song &song : GetCollectionSongs(collection_ids)) {
+    collection_songs.insert(song.id(), song);
+  }
 
   // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
   std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
-  QList<PlaylistItemPtr> playlistitems;
-  while (q.next()) {
-    playlistitems << NewPlaylistItemFromQuery(SqlRow(q), state_ptr);
+  for (const SqlRow &row : rows) {
+    PlaylistItemPtr item = NewPlaylistItemFromQuery(row, collection_songs, state_ptr);
+    *items << item;
+    if (saved) *saved << SavedItem(item, row.value(id_column).toLongLong(), row.value(position_column).toLongLong());
   }
-  return playlistitems;
+
+  return rows.count();
+
+}
+
+PlaylistBackend::ItemsChunk PlaylistBackend::GetPlaylistItemsChunk(int playlist, const ItemsCursor &cursor, int count) {
+
+  ItemsChunk chunk;
+  SavedItemList saved;
+  const int row_count = ReadPlaylistItems(playlist, cursor, count, &chunk.items, &saved);
+  if (row_count == -1) return chunk;
+
+  chunk.at_end = row_count < count;
+  if (!saved.isEmpty()) {
+    chunk.next.position = saved.last().position;
+    chunk.next.id = saved.last().id;
+  }
+
+  // Remember the rows once the whole playlist has been read, so the next save only has to write what changed.
+  QMutexLocker l(&saved_mutex_);
+  if (cursor.id == -1) {
+    loading_playlists_[playlist] = saved;
+  }
+  else if (loading_playlists_.contains(playlist)) {
+    loading_playlists_[playlist] << saved;
+  }
+  if (chunk.at_end && loading_playlists_.contains(playlist)) {
+    saved_playlists_[playlist] = loading_playlists_.take(playlist);
+  }
+
+  return chunk;
 
 }
 
 QList<Song> PlaylistBackend::GetPlaylistSongs(int playlist) {
 
-  QSqlQuery q = GetPlaylistRows(playlist);
-  // Note that as this only accesses the query, not the db, we don't need the mutex.
-  if (db_->CheckErrors(q)) return QList<Song>();
+  PlaylistItemList items;
+  if (ReadPlaylistItems(playlist, ItemsCursor(), -1, &items, nullptr) == -1) return QList<Song>();
 
-  // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
-  std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
   QList<Song> songs;
-  while (q.next()) {
-    songs << NewSongFromQuery(SqlRow(q), state_ptr);
+  for (PlaylistItemPtr item : items) {
+    songs << item->Metadata();
   }
   return songs;
 
 }
 
-PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
+SongList PlaylistBackend::GetCollectionSongs(const QList<int> &collection_ids) {
+
+  SongList ret;
+  for (int i = 0 ; i < collection_ids.count() ; i += kCollectionLookupChunkSize) {
+    ret << app_->collection_backend()->GetSongsById(collection_ids.mid(i, kCollectionLookupChunkSize));
+  }
+  return ret;
+
+}
+
+PlaylistBackend::PlaylistSummary PlaylistBackend::GetPlaylistSummary(int playlist) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Collection items only store a reference, their length is in the songs table.
+  QSqlQuery q(db);
+  q.prepare("SELECT COUNT(*), SUM(MAX(0, COALESCE(s.length, p.length, 0)))"
+            " FROM playlist_items AS p"
+            " LEFT JOIN songs AS s ON p.collection_id > 0 AND s.ROWID = p.collection_id"
+            " WHERE p.playlist = :playlist");
+  q.bindValue(":playlist", playlist);
+  q.exec();
+  if (db_->CheckErrors(q) || !q.next()) return PlaylistSummary();
+
+  PlaylistSummary summary;
+  summary.count = q.value(0).toInt();
+  summary.length_nanosec = q.value(1).toULongLong();
+  return summary;
+
+}
+
+PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, const QHash<int, Song> &collection_songs, std::shared_ptr<NewSongFromQueryState> state) {
 
-  // The song tables get joined first, plus one each for the song ROWIDs
-  const int playlist_row = (Song::kColumns.count() + 1) * kSongTableJoins;
+  // The type comes after the playlist ROWID and the song columns
+  const int type_column = Song::kColumns.count() + 1;
+  const Song::Source source = Song::Source(row.value(type_column).toInt());
+
+  if (source == Song::Source_Collection) {
+    // Songs that are no longer in the collection get an empty song, these are removed by the playlist.
+    return PlaylistItemPtr(new CollectionPlaylistItem(collection_songs.value(row.value(type_column + 1).toInt())));
+  }
 
-  PlaylistItemPtr item(PlaylistItem::NewFromSource(Song::Source(row.value(playlist_row).toInt())));
+  PlaylistItemPtr item(PlaylistItem::NewFromSource(source));
   if (item) {
     item->InitFromQuery(row);
     return RestoreCueData(item, state);
@@ -209,12 +311,6 @@ PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, std
 
 }
 
-Song PlaylistBackend::NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
-
-  return NewPlaylistItemFromQuery(row, state)->Metadata();
-
-}
-
 // If song had a CUE and the CUE still exists, the metadata from it will be applied here.
 
 PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state) {
@@ -240,10 +336,7 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, std::share
     QMutexLocker locker(&state->mutex_);
 
     if (!state->cached_cues_.contains(cue_path)) {
-      QFile cue(cue_path);
-      cue.open(QIODevice::ReadOnly);
-
-      song_list = cue_parser.Load(&cue, cue_path, QDir(cue_path.section('/', 0, -2)));
+      song_list = cue_parser.LoadFile(cue_path, QDir(cue_path.section('/', 0, -2)));
       state->cached_cues_[cue_path] = song_list;
     } else {
       song_list = state->cached_cues_[cue_path];
@@ -263,40 +356,50 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, std::share
 
 }
 
-void PlaylistBackend::SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played) {
+void PlaylistBackend::SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played, const PlaylistItemList &changed_items) {
 
-  metaObject()->invokeMethod(this, "SavePlaylist", Qt::QueuedConnection, Q_ARG(int, playlist), Q_ARG(PlaylistItemList, items), Q_ARG(int, last_played));
+  metaObject()->invokeMethod(this, "SavePlaylist", Qt::QueuedConnection, Q_ARG(int, playlist), Q_ARG(PlaylistItemList, items), Q_ARG(int, last_played), Q_ARG(PlaylistItemList, changed_items));
 
 }
 
-void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList &items, int last_played) {
+void PlaylistBackend::ForgetSavedRowsAsync(int playlist) {
+
+  metaObject()->invokeMethod(this, "ForgetSavedRows", Qt::QueuedConnection, Q_ARG(int, playlist));
+
+}
+
+void PlaylistBackend::ForgetSavedRows(int playlist) {
+
+  QMutexLocker l(&saved_mutex_);
+  saved_playlists_.remove(playlist);
+
+}
+
+void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList &items, int last_played, const PlaylistItemList &changed_items) {
 
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  qLog(Debug) << "Saving playlist" << playlist;
+  // Take the saved rows out while saving, if anything goes wrong the next save will rewrite the playlist.
+  bool have_saved = false;
+  SavedItemList saved;
+  {
+    QMutexLocker saved_locker(&saved_mutex_);
+    // Rows that are still being read won't match what we write now.
+    loading_playlists_.remove(playlist);
+    if (saved_playlists_.contains(playlist)) {
+      have_saved = true;
+      saved = saved_playlists_.take(playlist);
+    }
+  }
 
-  QSqlQuery clear(db);
-  clear.prepare("DELETE FROM playlist_items WHERE playlist = :playlist");
-  QSqlQuery insert(db);
-  insert.prepare("INSERT INTO playlist_items (playlist, type, collection_id, " + Song::kColumnSpec + ") VALUES (:playlist, :type, :collection_id, " + Song::kBindSpec + ")");
   QSqlQuery update(db);
   update.prepare("UPDATE playlists SET last_played=:last_played WHERE ROWID=:playlist");
 
   ScopedTransaction transaction(&db);
 
-  // Clear the existing items in the playlist
-  clear.bindValue(":playlist", playlist);
-  clear.exec();
-  if (db_->CheckErrors(clear)) return;
-
-  // Save the new ones
-  for (PlaylistItemPtr item : items) {
-    insert.bindValue(":playlist", playlist);
-    item->BindToQuery(&insert);
-
-    insert.exec();
-    db_->CheckErrors(insert);
+  if (!have_saved || !SavePlaylistChanges(db, playlist, items, changed_items, &saved)) {
+    if (!SavePlaylistFull(db, playlist, items, &saved)) return;
   }
 
   // Update the last played track number
@@ -307,6 +410,216 @@ void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList &items,
 
   transaction.Commit();
 
+  QMutexLocker saved_locker(&saved_mutex_);
+  saved_playlists_[playlist] = saved;
+
+}
+
+bool PlaylistBackend::InsertItem(QSqlQuery *insert, QSqlQuery *insert_reference, int playlist, PlaylistItemPtr item, qint64 position, qint64 *id) {
+
+  QSqlQuery *q = item->IsReferenceOnly() ? insert_reference : insert;
+  q->bindValue(":playlist", playlist);
+  q->bindValue(":position", position);
+  if (item->IsReferenceOnly()) item->BindReferenceToQuery(q);
+  else item->BindToQuery(q);
+
+  q->exec();
+  if (db_->CheckErrors(*q)) return false;
+
+  *id = q->lastInsertId().toLongLong();
+  return true;
+
+}
+
+bool PlaylistBackend::SavePlaylistFull(QSqlDatabase &db, int playlist, const PlaylistItemList &items, SavedItemList *saved) {
+
+  qLog(Debug) << "Saving playlist" << playlist;
+
+  QSqlQuery clear(db);
+  clear.prepare("DELETE FROM playlist_items WHERE playlist = :playlist");
+  QSqlQuery insert(db);
+  insert.prepare("INSERT INTO playlist_items (playlist, type, collection_id, position, " + Song::kColumnSpec + ") VALUES (:playlist, :type, :collection_id, :position, " + Song::kBindSpec + ")");
+  // Columns without a default are left empty for references.
+  QSqlQuery insert_reference(db);
+  insert_reference.prepare("INSERT INTO playlist_items (playlist, type, collection_id, position, title, album, artist, albumartist, genre, composer, performer, grouping, comment, lyrics) VALUES (:playlist, :type, :collection_id, :position, '', '', '', '', '', '', '', '', '', '')");
+
+  // Clear the existing items in the playlist
+  clear.bindValue(":playlist", playlist);
+  clear.exec();
+  if (db_->CheckErrors(clear)) return false;
+
+  // Save the new ones
+  saved->clear();
+  for (int i = 0 ; i < items.count() ; ++i) {
+    const qint64 position = i * kPositionStep;
+    qint64 id = -1;
+    if (!InsertItem(&insert, &insert_reference, playlist, items[i], position, &id)) return false;
+    *saved << SavedItem(items[i], id, position);
+  }
+
+  return true;
+
+}
+
+// Returns which of the matched rows are part of the longest run that is still in the old order, these don't have to move.
+// rows has the old row of each item, or -1 for new items.
+static QVector<bool> UnmovedRows(const QVector<int> &rows) {
+
+  // tails[k] is the index of the smallest last row of an increasing sequence of length k + 1.
+  QVector<int> tails;
+  QVector<int> previous(rows.count(), -1);
+  for (int i = 0 ; i < rows.count() ; ++i) {
+    if (rows[i] == -1) continue;
+    QVector<int>::iterator it = std::lower_bound(tails.begin(), tails.end(), rows[i], [&rows](int index, int row) { return rows[index] < row; });
+    if (it != tails.begin()) previous[i] = *(it - 1);
+    if (it == tails.end()) tails << i;
+    else *it = i;
+  }
+
+  QVector<bool> ret(rows.count(), false);
+  for (int i = tails.isEmpty() ? -1 : tails.last() ; i != -1 ; i = previous[i]) {
+    ret[i] = true;
+  }
+  return ret;
+
+}
+
+bool PlaylistBackend::SavePlaylistChanges(QSqlDatabase &db, int playlist, const PlaylistItemList &items, const PlaylistItemList &changed_items, SavedItemList *saved) {
+
+  const SavedItemList old_saved = *saved;
+
+  // Find the row each item was saved in.  The same item can be in a playlist more than once.
+  QHash<PlaylistItem*, QList<int>> old_rows_by_item;
+  for (int i = 0 ; i < old_saved.count() ; ++i) {
+    old_rows_by_item[old_saved[i].item.get()] << i;
+  }
+
+  QVector<int> old_rows(items.count(), -1);
+  QVector<bool> deleted(old_saved.count(), true);
+  int inserted_count = 0;
+  for (int i = 0 ; i < items.count() ; ++i) {
+    QHash<PlaylistItem*, QList<int>>::iterator it = old_rows_by_item.find(items[i].get());
+    if (it == old_rows_by_item.end() || it.value().isEmpty()) {
+      ++inserted_count;
+      continue;
+    }
+    old_rows[i] = it.value().takeFirst();
+    deleted[old_rows[i]] = false;
+  }
+
+  QSet<PlaylistItem*> changed;
+  for (PlaylistItemPtr item : changed_items) {
+    changed.insert(item.get());
+  }
+  int changed_count = 0;
+  for (int i = 0 ; i < items.count() ; ++i) {
+    if (old_rows[i] != -1 && changed.contains(items[i].get())) ++changed_count;
+  }
+
+  // Rewriting everything is cheaper than writing most of the rows one by one.
+  if (inserted_count + changed_count > items.count() * kFullSaveThreshold) return false;
+
+  // Items that are still in the same order keep their position, the others get new positions in the gaps between them.
+  const QVector<bool> unmoved = UnmovedRows(old_rows);
+  QVector<qint64> positions(items.count());
+  for (int i = 0 ; i < items.count() ;) {
+    if (unmoved[i]) {
+      positions[i] = old_saved[old_rows[i]].position;
+      ++i;
+      continue;
+    }
+
+    int end = i;
+    while (end < items.count() && !unmoved[end]) ++end;
+    const int count = end - i;
+
+    qint64 low = 0;
+    qint64 high = 0;
+    if (i == 0 && end == items.count()) {
+      high = (count + 1) * kPositionStep;
+    }
+    else if (i == 0) {
+      high = old_saved[old_rows[end]].position;
+      low = high - (count + 1) * kPositionStep;
+    }
+    else if (end == items.count()) {
+      low = positions[i - 1];
+      high = low + (count + 1) * kPositionStep;
+    }
+    else {
+      low = positions[i - 1];
+      high = old_saved[old_rows[end]].position;
+    }
+
+    if (high - low <= count) {
+      // There's no room left between the neighbours, renumber the whole playlist.
+      for (int j = 0 ; j < items.count() ; ++j) {
+        positions[j] = j * kPositionStep;
+      }
+      break;
+    }
+
+    for (int j = 0 ; j < count ; ++j) {
+      positions[i + j] = low + (high - low) * (j + 1) / (count + 1);
+    }
+    i = end;
+  }
+
+  QSqlQuery remove(db);
+  remove.prepare("DELETE FROM playlist_items WHERE ROWID = :id");
+  QSqlQuery insert(db);
+  insert.prepare("INSERT INTO playlist_items (playlist, type, collection_id, position, " + Song::kColumnSpec + ") VALUES (:playlist, :type, :collection_id, :position, " + Song::kBindSpec + ")");
+  // Columns without a default are left empty for references.
+  QSqlQuery insert_reference(db);
+  insert_reference.prepare("INSERT INTO playlist_items (playlist, type, collection_id, position, title, album, artist, albumartist, genre, composer, performer, grouping, comment, lyrics) VALUES (:playlist, :type, :collection_id, :position, '', '', '', '', '', '', '', '', '', '')");
+  QSqlQuery update(db);
+  update.prepare("UPDATE playlist_items SET type = :type, collection_id = :collection_id, position = :position, " + Song::kUpdateSpec + " WHERE ROWID = :id");
+  QSqlQuery move(db);
+  move.prepare("UPDATE playlist_items SET position = :position WHERE ROWID = :id");
+
+  int removed_count = 0;
+  for (int i = 0 ; i < old_saved.count() ; ++i) {
+    if (!deleted[i]) continue;
+    remove.bindValue(":id", old_saved[i].id);
+    remove.exec();
+    if (db_->CheckErrors(remove)) return false;
+    ++removed_count;
+  }
+
+  int moved_count = 0;
+  saved->clear();
+  for (int i = 0 ; i < items.count() ; ++i) {
+    PlaylistItemPtr item = items[i];
+    if (old_rows[i] == -1) {
+      qint64 id = -1;
+      if (!InsertItem(&insert, &insert_reference, playlist, item, positions[i], &id)) return false;
+      *saved << SavedItem(item, id, positions[i]);
+      continue;
+    }
+
+    // References don't have any metadata to update.
+    const SavedItem &old_item = old_saved[old_rows[i]];
+    if (changed.contains(item.get()) && !item->IsReferenceOnly()) {
+      update.bindValue(":id", old_item.id);
+      update.bindValue(":position", positions[i]);
+      item->BindToQuery(&update);
+      update.exec();
+      if (db_->CheckErrors(update)) return false;
+    }
+    else if (positions[i] != old_item.position) {
+      move.bindValue(":id", old_item.id);
+      move.bindValue(":position", positions[i]);
+      move.exec();
+      if (db_->CheckErrors(move)) return false;
+      ++moved_count;
+    }
+    *saved << SavedItem(item, old_item.id, positions[i]);
+  }
+
+  qLog(Debug) << "Saving playlist" << playlist << "changes:" << inserted_count << "inserted," << removed_count << "removed," << moved_count << "moved," << changed_count << "changed";
+
+  return true;
+
 }
 
 int PlaylistBackend::CreatePlaylist(const QString &name, const QString &special_type) {
@@ -347,6 +660,10 @@ void PlaylistBackend::RemovePlaylist(int id) {
 
   transaction.Commit();
 
+  QMutexLocker saved_locker(&saved_mutex_);
+  loading_playlists_.remove(id);
+  saved_playlists_.remove(id);
+
 }
 
 void PlaylistBackend::RenamePlaylist(int id, const QString &new_name) {
@@ -418,3 +735,16 @@ void PlaylistBackend::SetPlaylistUiPath(int id, const QString &path) {
 
 }
 
+void PlaylistBackend::SetSmartPlaylistData(int id, const QByteArray &data) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  QSqlQuery q(db);
+  q.prepare("UPDATE playlists SET smart_playlist_data=:data WHERE ROWID=:id");
+  q.bindValue(":data", data);
+  q.bindValue(":id", id);
+
+  q.exec();
+  db_->CheckErrors(q);
+
+}
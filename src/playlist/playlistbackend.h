@@ -31,8 +31,10 @@
 #include <QHash>
 #include <QList>
 #include <QSet>
+#include <QByteArray>
 #include <QString>
 #include <QVector>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 
 #include "core/song.h"
@@ -57,24 +59,59 @@ class PlaylistBackend : public QObject {
     bool favorite;
     int last_played;
     QString special_type;
+    // The serialised SmartPlaylistSearch of smart playlists.
+    QByteArray smart_playlist_data;
   };
   typedef QList<Playlist> PlaylistList;
 
-  static const int kSongTableJoins;
+  // Where to continue reading a playlist that is restored in chunks.
+  struct ItemsCursor {
+    ItemsCursor() : position(0), id(-1) {}
+
+    qint64 position;
+    qint64 id;
+  };
+
+  // The size of a playlist, without reading its items.
+  struct PlaylistSummary {
+    PlaylistSummary() : count(0), length_nanosec(0) {}
+
+    int count;
+    quint64 length_nanosec;
+  };
+
+  struct ItemsChunk {
+    ItemsChunk() : at_end(true) {}
+
+    PlaylistItemList items;
+    ItemsCursor next;
+    bool at_end;
+  };
+
+  static const int kCollectionLookupChunkSize;
+  static const qint64 kPositionStep;
+  static const double kFullSaveThreshold;
 
   PlaylistList GetAllPlaylists();
   PlaylistList GetAllOpenPlaylists();
   PlaylistList GetAllFavoritePlaylists();
   PlaylistBackend::Playlist GetPlaylist(int id);
 
-  QList<PlaylistItemPtr> GetPlaylistItems(int playlist);
+  // Reads up to count items following the cursor, in playlist order.
+  ItemsChunk GetPlaylistItemsChunk(int playlist, const ItemsCursor &cursor, int count);
   QList<Song> GetPlaylistSongs(int playlist);
+  PlaylistSummary GetPlaylistSummary(int playlist);
+  // Looks up collection songs kCollectionLookupChunkSize at a time, songs that are no longer in the collection are left out.
+  SongList GetCollectionSongs(const QList<int> &collection_ids);
 
   void SetPlaylistOrder(const QList<int> &ids);
   void SetPlaylistUiPath(int id, const QString &path);
+  void SetSmartPlaylistData(int id, const QByteArray &data);
 
   int CreatePlaylist(const QString &name, const QString &special_type);
-  void SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played);
+  void SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played, const PlaylistItemList &changed_items = PlaylistItemList());
+  // Drops the rows remembered for incremental saves after any pending save, so the items of an unloaded playlist can be freed.
+  void ForgetSavedRowsAsync(int playlist);
   void RenamePlaylist(int id, const QString &new_name);
   void FavoritePlaylist(int id, bool is_favorite);
   void RemovePlaylist(int id);
@@ -82,7 +119,10 @@ class PlaylistBackend : public QObject {
   Application *app() const { return app_; }
 
  public slots:
-  void SavePlaylist(int playlist, const PlaylistItemList &items, int last_played);
+  // Writes only the rows that changed since the playlist was last loaded or saved, falling back to rewriting the whole playlist.
+  // changed_items are items whose metadata was changed in place.
+  void SavePlaylist(int playlist, const PlaylistItemList &items, int last_played, const PlaylistItemList &changed_items);
+  void ForgetSavedRows(int playlist);
 
  private:
   struct NewSongFromQueryState {
@@ -90,10 +130,27 @@ class PlaylistBackend : public QObject {
     QMutex mutex_;
   };
 
-  QSqlQuery GetPlaylistRows(int playlist);
+  // A row in playlist_items as we last loaded or saved it.
+  struct SavedItem {
+    SavedItem() : id(-1), position(0) {}
+    SavedItem(PlaylistItemPtr _item, qint64 _id, qint64 _position) : item(_item), id(_id), position(_position) {}
+
+    PlaylistItemPtr item;
+    qint64 id;
+    qint64 position;
+  };
+  typedef QList<SavedItem> SavedItemList;
+
+  QSqlQuery GetPlaylistRows(int playlist, const ItemsCursor &cursor, int count);
+  // Returns the number of rows read, or -1 on error.
+  int ReadPlaylistItems(int playlist, const ItemsCursor &cursor, int count, PlaylistItemList *items, SavedItemList *saved);
+
+  PlaylistItemPtr NewPlaylistItemFromQuery(const SqlRow &row, const QHash<int, Song> &collection_songs, std::shared_ptr<NewSongFromQueryState> state);
+
+  bool InsertItem(QSqlQuery *insert, QSqlQuery *insert_reference, int playlist, PlaylistItemPtr item, qint64 position, qint64 *id);
+  bool SavePlaylistFull(QSqlDatabase &db, int playlist, const PlaylistItemList &items, SavedItemList *saved);
+  bool SavePlaylistChanges(QSqlDatabase &db, int playlist, const PlaylistItemList &items, const PlaylistItemList &changed_items, SavedItemList *saved);
 
-  Song NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
-  PlaylistItemPtr NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
   PlaylistItemPtr RestoreCueData(PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state);
 
   enum GetPlaylistsFlags {
@@ -105,6 +162,12 @@ class PlaylistBackend : public QObject {
 
   Application *app_;
   Database *db_;
+
+  // The saved rows of each playlist, in playlist order.  Playlists without an entry are rewritten completely on the next save.
+  QMutex saved_mutex_;
+  QHash<int, SavedItemList> saved_playlists_;
+  // Rows read so far of playlists that are being restored in chunks.
+  QHash<int, SavedItemList> loading_playlists_;
 };
 
 #endif  // PLAYLISTBACKEND_H
@@ -33,6 +33,9 @@
 #include <QDir>
 #include <QFont>
 #include <QFontMetrics>
+#include <QStaticText>
+#include <QStyle>
+#include <QTransform>
 #include <QHeaderView>
 #include <QLocale>
 #include <QMetaType>
@@ -47,6 +50,7 @@
 #include <QColor>
 #include <QPen>
 #include <QBrush>
+#include <QPalette>
 #include <QPoint>
 #include <QRect>
 #include <QSize>
@@ -71,6 +75,7 @@
 #include "collection/collectionbackend.h"
 #include "playlist/playlist.h"
 #include "playlistdelegates.h"
+#include "playlistview.h"
 
 #ifdef Q_OS_MACOS
 #include "core/mac_utilities.h"
@@ -92,6 +97,11 @@ QueuedItemDelegate::QueuedItemDelegate(QObject *parent, int indicator_column)
 void QueuedItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
 
   QStyledItemDelegate::paint(painter, option, index);
+  DrawQueueIndicator(painter, option, index);
+
+}
+
+void QueuedItemDelegate::DrawQueueIndicator(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
 
   if (index.column() == indicator_column_) {
     bool ok = false;
@@ -162,7 +172,11 @@ int QueuedItemDelegate::queue_indicator_size(const QModelIndex &index) const {
 
 
 PlaylistDelegateBase::PlaylistDelegateBase(QObject *parent, const QString &suffix)
-    : QueuedItemDelegate(parent), view_(qobject_cast<QTreeView*>(parent)), suffix_(suffix)
+    : QueuedItemDelegate(parent),
+      view_(qobject_cast<QTreeView*>(parent)),
+      playlist_view_(qobject_cast<PlaylistView*>(parent)),
+      suffix_(suffix),
+      cache_text_(true)
 {
 }
 
@@ -204,7 +218,22 @@ QSize PlaylistDelegateBase::sizeHint(const QStyleOptionViewItem &option, const Q
 
 void PlaylistDelegateBase::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
 
-  QueuedItemDelegate::paint(painter, Adjusted(option, index), index);
+  const QStyleOptionViewItem adjusted = Adjusted(option, index);
+
+  if (playlist_view_ && cache_text_) {
+    QStyleOptionViewItem opt(adjusted);
+    InitStyleOptionWithoutText(&opt, index);
+
+    // Let the style draw the background, selection and focus, then draw the prepared text on top.
+    QStyle *style = opt.widget ? opt.widget->style() : view_->style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+    DrawText(painter, opt, *PreparedText(opt, index));
+
+    DrawQueueIndicator(painter, adjusted, index);
+  }
+  else {
+    QueuedItemDelegate::paint(painter, adjusted, index);
+  }
 
   // Stop after indicator
   if (index.column() == Playlist::Column_Title) {
@@ -238,6 +267,78 @@ QStyleOptionViewItem PlaylistDelegateBase::Adjusted(const QStyleOptionViewItem &
 
 }
 
+void PlaylistDelegateBase::InitStyleOptionWithoutText(QStyleOptionViewItem *option, const QModelIndex &index) const {
+
+  // Does the same as QStyledItemDelegate::initStyleOption() for the roles Playlist provides, except for the display text.
+
+  QVariant value = index.data(Qt::FontRole);
+  if (value.isValid() && !value.isNull()) {
+    option->font = qvariant_cast<QFont>(value).resolve(option->font);
+    option->fontMetrics = QFontMetrics(option->font);
+  }
+
+  value = index.data(Qt::TextAlignmentRole);
+  if (value.isValid() && !value.isNull()) {
+    option->displayAlignment = Qt::Alignment(value.toInt());
+  }
+
+  value = index.data(Qt::ForegroundRole);
+  if (value.canConvert<QBrush>()) {
+    option->palette.setBrush(QPalette::Text, qvariant_cast<QBrush>(value));
+  }
+
+  option->index = index;
+  option->backgroundBrush = qvariant_cast<QBrush>(index.data(Qt::BackgroundRole));
+
+}
+
+PlaylistDelegateBase::CachedText *PlaylistDelegateBase::PreparedText(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+
+  CachedText *text = playlist_view_->cached_text(index);
+  if (!text) {
+    text = new CachedText;
+    const QVariant value = index.data(Qt::DisplayRole);
+    if (value.isValid() && !value.isNull()) text->text = displayText(value, option.locale);
+    text = playlist_view_->insert_cached_text(index, text);
+  }
+
+  // Same margins as QCommonStyle uses for item view text.
+  const int text_margin = (option.widget ? option.widget->style() : view_->style())->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, option.widget) + 1;
+  const int width = option.rect.width() - text_margin * 2;
+
+  if (!text->text.isEmpty() && (text->width != width || text->font != option.font)) {
+    text->width = width;
+    text->font = option.font;
+    text->static_text.setTextFormat(Qt::PlainText);
+    text->static_text.setText(option.fontMetrics.elidedText(text->text, option.textElideMode, width));
+    text->static_text.prepare(QTransform(), option.font);
+  }
+
+  return text;
+
+}
+
+void PlaylistDelegateBase::DrawText(QPainter *painter, const QStyleOptionViewItem &option, const CachedText &text) {
+
+  if (text.text.isEmpty()) return;
+
+  QPalette::ColorGroup group = option.state & QStyle::State_Enabled ? QPalette::Normal : QPalette::Disabled;
+  if (group == QPalette::Normal && !(option.state & QStyle::State_Active)) group = QPalette::Inactive;
+
+  // The text was elided to the width left between the margins.
+  const int margin = (option.rect.width() - text.width) / 2;
+  const QRect text_rect = option.rect.adjusted(margin, 0, -margin, 0);
+  const QRect rect = QStyle::alignedRect(option.direction, option.displayAlignment, text.static_text.size().toSize(), text_rect);
+
+  painter->save();
+  painter->setFont(text.font);
+  painter->setPen(option.palette.color(group, option.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text));
+  painter->setClipRect(text_rect, Qt::IntersectClip);
+  painter->drawStaticText(rect.topLeft(), text.static_text);
+  painter->restore();
+
+}
+
 bool PlaylistDelegateBase::helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index) {
 
   // This function is copied from QAbstractItemDelegate, and changed to show displayText() in the tooltip, rather than the index's naked Qt::ToolTipRole text.
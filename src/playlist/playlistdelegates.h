@@ -40,6 +40,7 @@
 #include <QColor>
 #include <QSize>
 #include <QFont>
+#include <QStaticText>
 #include <QString>
 #include <QStringListModel>
 #include <QModelIndex>
@@ -55,11 +56,13 @@
 
 class CollectionBackend;
 class Player;
+class PlaylistView;
 
 class QueuedItemDelegate : public QStyledItemDelegate {
 public:
   QueuedItemDelegate(QObject *parent, int indicator_column = Playlist::Column_Title);
   void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+  void DrawQueueIndicator(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
   void DrawBox(QPainter *painter, const QRect &line_rect, const QFont &font, const QString &text, int width = -1) const;
 
   int queue_indicator_size(const QModelIndex &index) const;
@@ -88,12 +91,31 @@ class PlaylistDelegateBase : public QueuedItemDelegate {
 
   static const int kMinHeight;
 
+  // The display text of a cell, elided and laid out for the width it was last drawn with.
+  // Kept by PlaylistView so scrolling doesn't format and lay out the same text again on every paint.
+  struct CachedText {
+    CachedText() : width(-1) {}
+
+    QString text;
+    QFont font;
+    int width;
+    QStaticText static_text;
+  };
+
  public slots:
   bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index);
 
  protected:
   QTreeView *view_;
+  PlaylistView *playlist_view_;
   QString suffix_;
+  // False for delegates whose text changes without the model data changing, their text is formatted on every paint.
+  bool cache_text_;
+
+ private:
+  void InitStyleOptionWithoutText(QStyleOptionViewItem *option, const QModelIndex &index) const;
+  CachedText *PreparedText(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+  static void DrawText(QPainter *painter, const QStyleOptionViewItem &option, const CachedText &text);
 };
 
 class LengthItemDelegate : public PlaylistDelegateBase {
@@ -116,7 +138,7 @@ class DateItemDelegate : public PlaylistDelegateBase {
 
 class LastPlayedItemDelegate : public PlaylistDelegateBase {
 public:
-  LastPlayedItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
+  LastPlayedItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) { cache_text_ = false; }
   QString displayText(const QVariant &value, const QLocale &locale) const;
 };
 
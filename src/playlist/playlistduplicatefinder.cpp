@@ -0,0 +1,126 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QUrl>
+
+#include "core/song.h"
+#include "core/taskmanager.h"
+#include "core/timeconstants.h"
+#include "playlistduplicatefinder.h"
+
+const qint64 PlaylistDuplicateFinder::kLengthToleranceNanosec = 2 * kNsecPerSec;
+const int PlaylistDuplicateFinder::kProgressInterval = 1000;
+
+namespace {
+
+// The song that is kept so far for a key.
+struct KeptSong {
+  KeptSong() : list(-1), index(-1), bitrate(0), length(0) {}
+  KeptSong(int _list, int _index, const Song &song) : list(_list), index(_index), bitrate(song.bitrate()), length(song.length_nanosec()) {}
+
+  int list;
+  int index;
+  int bitrate;
+  qint64 length;
+};
+
+typedef QPair<QUrl, qint64> FileKey;
+// Normalised artist and title, and the length bucket.
+typedef QPair<QString, qint64> SimilarKey;
+
+qint64 LengthBucket(qint64 length) {
+  if (length <= 0) return -1;
+  return length / PlaylistDuplicateFinder::kLengthToleranceNanosec;
+}
+
+}
+
+QString PlaylistDuplicateFinder::NormaliseText(const QString &text) {
+  return text.toCaseFolded().simplified();
+}
+
+QList<QList<int>> PlaylistDuplicateFinder::Find(const QList<SongList> &lists, Mode mode, TaskManager *task_manager, int task_id) {
+
+  int total = 0;
+  for (const SongList &songs : lists) total += songs.count();
+
+  QList<QList<int>> ret;
+  for (int i = 0 ; i < lists.count() ; ++i) ret << QList<int>();
+
+  QHash<FileKey, KeptSong> by_file;
+  QHash<SimilarKey, KeptSong> by_similar;
+
+  int done = 0;
+  for (int list = 0 ; list < lists.count() ; ++list) {
+    const SongList &songs = lists[list];
+    for (int index = 0 ; index < songs.count() ; ++index) {
+      const Song &song = songs[index];
+      KeptSong *kept = nullptr;
+
+      if (mode == Mode_SameFile) {
+        const FileKey key(song.url(), song.beginning_nanosec());
+        if (by_file.contains(key)) kept = &by_file[key];
+        else by_file.insert(key, KeptSong(list, index, song));
+      }
+      else {
+        // Songs in the neighbouring length buckets are similar too, as long as their lengths are close enough.
+        const QString text = NormaliseText(song.artist()) + QChar(0) + NormaliseText(song.title());
+        const qint64 bucket = LengthBucket(song.length_nanosec());
+        for (qint64 b = bucket - 1 ; b <= bucket + 1 && !kept ; ++b) {
+          if ((bucket == -1) != (b == -1)) continue;
+          QHash<SimilarKey, KeptSong>::iterator it = by_similar.find(SimilarKey(text, b));
+          if (it == by_similar.end()) continue;
+          if (b == bucket || qAbs(it.value().length - song.length_nanosec()) <= kLengthToleranceNanosec) kept = &it.value();
+        }
+        if (!kept) by_similar.insert(SimilarKey(text, bucket), KeptSong(list, index, song));
+      }
+
+      if (kept) {
+        // The order of the lists wins over the bitrate, so only a song in the same list can replace the kept one.
+        if (list == kept->list && song.bitrate() > kept->bitrate) {
+          ret[kept->list] << kept->index;
+          *kept = KeptSong(list, index, song);
+        }
+        else {
+          ret[list] << index;
+        }
+      }
+
+      if (task_manager && ++done % kProgressInterval == 0) {
+        task_manager->SetTaskProgress(task_id, done, total);
+      }
+    }
+  }
+
+  for (QList<int> &indices : ret) {
+    std::sort(indices.begin(), indices.end());
+  }
+
+  return ret;
+
+}
@@ -0,0 +1,55 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLAYLISTDUPLICATEFINDER_H
+#define PLAYLISTDUPLICATEFINDER_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QList>
+#include <QString>
+
+#include "core/song.h"
+
+class TaskManager;
+
+// Finds duplicate songs in one or more song lists with one hash lookup per song.
+class PlaylistDuplicateFinder {
+ public:
+  enum Mode {
+    // Same URL and beginning, so the tracks of a CUE sheet aren't duplicates of each other.
+    Mode_SameFile,
+    // Same artist and title after normalising, and about the same length.
+    Mode_Similar
+  };
+
+  // Songs with lengths further apart than this are never similar.
+  static const qint64 kLengthToleranceNanosec;
+  static const int kProgressInterval;
+
+  // Returns the indices of the duplicates in each of the lists.  Songs in earlier lists are always kept over songs in later lists.
+  // Within one list, of each set of duplicates the song with the highest bitrate is kept, otherwise the first one.
+  // If task_manager is set, the progress is reported to the given task.  Can be called from any thread.
+  static QList<QList<int>> Find(const QList<SongList> &lists, Mode mode, TaskManager *task_manager, int task_id);
+
+  static QString NormaliseText(const QString &text);
+};
+
+#endif  // PLAYLISTDUPLICATEFINDER_H
@@ -23,6 +23,11 @@
 #include <stdbool.h>
 
 #include <QObject>
+#include <QtGlobal>
+#include <QtConcurrentMap>
+#include <QList>
+#include <QSet>
+#include <QVariant>
 #include <QString>
 #include <QRegExp>
 #include <QAbstractItemModel>
@@ -32,6 +37,8 @@
 #include "playlistfilter.h"
 #include "playlistfilterparser.h"
 
+const int PlaylistFilter::kEvaluateChunkSize = 4096;
+
 PlaylistFilter::PlaylistFilter(QObject *parent)
     : QSortFilterProxyModel(parent),
       filter_tree_(new NopFilter),
@@ -77,8 +84,36 @@ void PlaylistFilter::sort(int column, Qt::SortOrder order) {
   sourceModel()->sort(column, order);
 }
 
+void PlaylistFilter::setSourceModel(QAbstractItemModel *source_model) {
+
+  if (sourceModel()) {
+    disconnect(sourceModel(), SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(SourceRowsInserted(QModelIndex, int, int)));
+    disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(SourceRowsRemoved(QModelIndex, int, int)));
+    disconnect(sourceModel(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
+    disconnect(sourceModel(), SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(Invalidate()));
+    disconnect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(Invalidate()));
+    disconnect(sourceModel(), SIGNAL(modelReset()), this, SLOT(Invalidate()));
+  }
+
+  // Connected before QSortFilterProxyModel connects its own slots, so the columns are up to date by the time it calls filterAcceptsRow() for the changed rows.
+  if (source_model) {
+    connect(source_model, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(SourceRowsInserted(QModelIndex, int, int)));
+    connect(source_model, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(SourceRowsRemoved(QModelIndex, int, int)));
+    connect(source_model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
+    connect(source_model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), SLOT(Invalidate()));
+    connect(source_model, SIGNAL(layoutChanged()), SLOT(Invalidate()));
+    connect(source_model, SIGNAL(modelReset()), SLOT(Invalidate()));
+  }
+
+  Invalidate();
+  QSortFilterProxyModel::setSourceModel(source_model);
+
+}
+
 bool PlaylistFilter::filterAcceptsRow(int row, const QModelIndex &parent) const {
 
+  Q_UNUSED(parent);
+
   QString filter = filterRegExp().pattern();
 
   uint hash = qHash(filter);
@@ -88,9 +123,154 @@ bool PlaylistFilter::filterAcceptsRow(int row, const QModelIndex &parent) const
     filter_tree_.reset(p.parse());
 
     query_hash_ = hash;
+    accepted_.clear();
+  }
+
+  if (filter_tree_->type() == FilterTree::Nop) return true;
+
+  // Test all rows at once the first time, then just look up the result
+  if (accepted_.count() != sourceModel()->rowCount()) Evaluate();
+
+  return accepted_.value(row, false);
+
+}
+
+void PlaylistFilter::Evaluate() const {
+
+  const int row_count = sourceModel()->rowCount();
+
+  // Columns extracted for an earlier filter are kept, the next one is likely to use them too while the filter text is being typed.
+  if (!extracted_columns_.isEmpty() && columns_[extracted_columns_.first()].text.count() != row_count) {
+    columns_.clear();
+    extracted_columns_.clear();
   }
+  if (columns_.isEmpty()) columns_.resize(Playlist::ColumnCount);
+
+  QSet<int> used_columns;
+  filter_tree_->columns(&used_columns);
+
+  QList<int> missing_columns;
+  for (int column : used_columns) {
+    if (extracted_columns_.contains(column)) continue;
+    AddColumn(column);
+    missing_columns << column;
+  }
+
+  accepted_.fill(false, row_count);
+  RunChunks(0, row_count, missing_columns, true);
+
+}
+
+void PlaylistFilter::UpdateRows(int first, int last) const {
+
+  // Results are only kept up to date if all rows have been evaluated for the current filter.
+  const bool evaluate = filter_tree_->type() != FilterTree::Nop && accepted_.count() == sourceModel()->rowCount();
+  if (extracted_columns_.isEmpty() && !evaluate) return;
+
+  RunChunks(first, last + 1, extracted_columns_, evaluate);
+
+}
+
+void PlaylistFilter::AddColumn(int column) const {
+
+  FilterColumn &data = columns_[column];
+  const int row_count = sourceModel()->rowCount();
+
+  data.numerical = numerical_columns_.contains(column);
+  data.text.resize(row_count);
+  if (data.numerical) data.numbers.resize(row_count);
+  extracted_columns_ << column;
+
+}
+
+void PlaylistFilter::RunChunks(int begin, int end, const QList<int> &missing_columns, bool evaluate) const {
+
+  QList<Chunk> chunks;
+  for (int i = begin ; i < end ; i += kEvaluateChunkSize) {
+    Chunk chunk;
+    chunk.playlist = static_cast<const Playlist*>(sourceModel());
+    chunk.tree = evaluate ? filter_tree_.data() : nullptr;
+    chunk.columns = &columns_;
+    chunk.accepted = &accepted_;
+    chunk.missing_columns = missing_columns;
+    chunk.begin = i;
+    chunk.end = qMin(i + kEvaluateChunkSize, end);
+    chunks << chunk;
+  }
+
+  // Every chunk only writes to its own rows, and the vectors have already been resized, so they're never detached from the worker threads.
+  if (chunks.count() == 1) {
+    EvaluateChunk(chunks.first());
+  }
+  else if (!chunks.isEmpty()) {
+    QtConcurrent::blockingMap(chunks, &PlaylistFilter::EvaluateChunk);
+  }
+
+}
+
+void PlaylistFilter::EvaluateChunk(Chunk &chunk) {
+
+  for (int row = chunk.begin ; row < chunk.end ; ++row) {
+    if (!chunk.missing_columns.isEmpty()) ExtractRow(chunk.playlist, chunk.missing_columns, row, chunk.columns);
+    if (chunk.tree) (*chunk.accepted)[row] = chunk.tree->accept(row, *chunk.columns);
+  }
+
+}
+
+void PlaylistFilter::ExtractRow(const Playlist *playlist, const QList<int> &columns, int row, FilterColumns *data) {
+
+  const Song song = playlist->item_at(row)->Metadata();
+  for (int column : columns) {
+    const QVariant value = Playlist::column_value(song, column);
+    FilterColumn &column_data = (*data)[column];
+    column_data.text[row] = value.toString().toLower();
+    if (column_data.numerical) column_data.numbers[row] = value.toLongLong();
+  }
+
+}
+
+void PlaylistFilter::SourceRowsInserted(const QModelIndex &parent, int first, int last) {
+
+  Q_UNUSED(parent);
+
+  const int count = last - first + 1;
+  for (int column : extracted_columns_) {
+    FilterColumn &data = columns_[column];
+    data.text.insert(first, count, QString());
+    if (data.numerical) data.numbers.insert(first, count, 0);
+  }
+  if (!accepted_.isEmpty()) accepted_.insert(first, count, false);
+
+  UpdateRows(first, last);
+
+}
+
+void PlaylistFilter::SourceRowsRemoved(const QModelIndex &parent, int first, int last) {
+
+  Q_UNUSED(parent);
+
+  const int count = last - first + 1;
+  for (int column : extracted_columns_) {
+    FilterColumn &data = columns_[column];
+    data.text.remove(first, count);
+    if (data.numerical) data.numbers.remove(first, count);
+  }
+  if (accepted_.count() > last) accepted_.remove(first, count);
+  else accepted_.clear();
+
+}
+
+void PlaylistFilter::SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right) {
+
+  if (!top_left.isValid() || !bottom_right.isValid()) return;
+  UpdateRows(top_left.row(), bottom_right.row());
+
+}
+
+void PlaylistFilter::Invalidate() {
 
-  // Test the row
-  return filter_tree_->accept(row, parent, sourceModel());
+  columns_.clear();
+  extracted_columns_.clear();
+  accepted_.clear();
 
 }
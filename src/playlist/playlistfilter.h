@@ -27,15 +27,20 @@
 
 #include <QtGlobal>
 #include <QObject>
+#include <QList>
 #include <QMap>
 #include <QSet>
+#include <QVector>
 #include <QScopedPointer>
 #include <QString>
+#include <QAbstractItemModel>
 #include <QSortFilterProxyModel>
 
 #include "playlist.h"
+#include "playlistfilterparser.h"
 
-class FilterTree;
+// The filter is evaluated for all rows at once when the filter text changes, over column values extracted from the playlist items.
+// The extracted columns and the results are kept up to date as rows are inserted, removed or changed, so filterAcceptsRow() is just a lookup.
 
 class PlaylistFilter : public QSortFilterProxyModel {
   Q_OBJECT
@@ -44,18 +49,58 @@ class PlaylistFilter : public QSortFilterProxyModel {
   PlaylistFilter(QObject *parent = nullptr);
   ~PlaylistFilter();
 
+  static const int kEvaluateChunkSize;
+
   // QAbstractItemModel
   void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
 
+  // QAbstractProxyModel
+  void setSourceModel(QAbstractItemModel *source_model);
+
   // QSortFilterProxyModel
   // public so Playlist::NextVirtualIndex and friends can get at it
   bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
 
-private:
+ private slots:
+  void SourceRowsInserted(const QModelIndex &parent, int first, int last);
+  void SourceRowsRemoved(const QModelIndex &parent, int first, int last);
+  void SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
+  void Invalidate();
+
+ private:
+  // A range of rows evaluated by one thread.
+  struct Chunk {
+    Chunk() : playlist(nullptr), tree(nullptr), columns(nullptr), accepted(nullptr), begin(0), end(0) {}
+
+    const Playlist *playlist;
+    const FilterTree *tree;
+    FilterColumns *columns;
+    QVector<bool> *accepted;
+    // Columns that need to be filled in for these rows.
+    QList<int> missing_columns;
+    int begin;
+    int end;
+  };
+
+  void Evaluate() const;
+  void UpdateRows(int first, int last) const;
+  void AddColumn(int column) const;
+  // Extracts the missing columns for the rows in [begin, end) and evaluates the filter tree for them if evaluate is true.
+  void RunChunks(int begin, int end, const QList<int> &missing_columns, bool evaluate) const;
+  static void EvaluateChunk(Chunk &chunk);
+  static void ExtractRow(const Playlist *playlist, const QList<int> &columns, int row, FilterColumns *data);
+
+ private:
   // Mutable because they're modified from filterAcceptsRow() const
   mutable QScopedPointer<FilterTree> filter_tree_;
   mutable uint query_hash_;
 
+  // Columns used by the filter tree, one entry per row of the playlist.
+  mutable FilterColumns columns_;
+  mutable QList<int> extracted_columns_;
+  // Result of the filter tree for each row, empty if it needs to be evaluated again.
+  mutable QVector<bool> accepted_;
+
   QMap<QString, int> column_names_;
   QSet<int> numerical_columns_;
 };
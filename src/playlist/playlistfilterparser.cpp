@@ -30,7 +30,6 @@
 #include <QVariant>
 #include <QString>
 #include <QtAlgorithms>
-#include <QAbstractItemModel>
 
 #include "playlist.h"
 #include "playlistfilterparser.h"
@@ -39,6 +38,11 @@ class SearchTermComparator {
  public:
   virtual ~SearchTermComparator() {}
   virtual bool Matches(const QString &element) const = 0;
+  // Used instead of Matches() for numerical columns, by default the value is compared as text.
+  virtual bool MatchesNumber(qint64 value, const QString &element) const {
+    Q_UNUSED(value);
+    return Matches(element);
+  }
 };
 
 // "compares" by checking if the field contains the search term
@@ -118,6 +122,9 @@ class GtComparator : public SearchTermComparator {
   virtual bool Matches(const QString &element) const {
     return element.toInt() > search_term_;
   }
+  virtual bool MatchesNumber(qint64 value, const QString&) const {
+    return value > search_term_;
+  }
  private:
   int search_term_;
 };
@@ -128,6 +135,9 @@ class GeComparator : public SearchTermComparator {
   virtual bool Matches(const QString &element) const {
     return element.toInt() >= search_term_;
   }
+  virtual bool MatchesNumber(qint64 value, const QString&) const {
+    return value >= search_term_;
+  }
  private:
   int search_term_;
 };
@@ -138,6 +148,9 @@ class LtComparator : public SearchTermComparator {
   virtual bool Matches(const QString &element) const {
     return element.toInt() < search_term_;
   }
+  virtual bool MatchesNumber(qint64 value, const QString&) const {
+    return value < search_term_;
+  }
  private:
   int search_term_;
 };
@@ -148,6 +161,22 @@ class LeComparator : public SearchTermComparator {
   virtual bool Matches(const QString &element) const {
     return element.toInt() <= search_term_;
   }
+  virtual bool MatchesNumber(qint64 value, const QString&) const {
+    return value <= search_term_;
+  }
+ private:
+  int search_term_;
+};
+
+class NumericalEqComparator : public SearchTermComparator {
+ public:
+  explicit NumericalEqComparator(int value) : search_term_(value) {}
+  virtual bool Matches(const QString &element) const {
+    return element.toInt() == search_term_;
+  }
+  virtual bool MatchesNumber(qint64 value, const QString&) const {
+    return value == search_term_;
+  }
  private:
   int search_term_;
 };
@@ -165,6 +194,12 @@ class DropTailComparatorDecorator : public SearchTermComparator {
     else
       return cmp_->Matches(element);
   }
+  virtual bool MatchesNumber(qint64 value, const QString &element) const {
+    if (element.length() > 9)
+      return cmp_->MatchesNumber(value / 1000000000LL, element.left(element.length() - 9));
+    else
+      return cmp_->MatchesNumber(value, element);
+  }
  private:
   QScopedPointer<SearchTermComparator> cmp_;
 };
@@ -185,13 +220,15 @@ class FilterTerm : public FilterTree {
  public:
   explicit FilterTerm(SearchTermComparator *comparator, const QList<int> &columns) : cmp_(comparator), columns_(columns) {}
 
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const {
+  virtual bool accept(int row, const FilterColumns &columns) const {
     for (int i : columns_) {
-      QModelIndex idx(model->index(row, i, parent));
-      if (cmp_->Matches(idx.data().toString().toLower())) return true;
+      if (cmp_->Matches(columns[i].text[row])) return true;
     }
     return false;
   }
+  virtual void columns(QSet<int> *columns) const {
+    for (int i : columns_) columns->insert(i);
+  }
   virtual FilterType type() { return Term; }
  private:
   QScopedPointer<SearchTermComparator> cmp_;
@@ -203,10 +240,12 @@ class FilterColumnTerm : public FilterTree {
  public:
   FilterColumnTerm(int column, SearchTermComparator *comparator) : col(column), cmp_(comparator) {}
 
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const {
-    QModelIndex idx(model->index(row, col, parent));
-    return cmp_->Matches(idx.data().toString().toLower());
+  virtual bool accept(int row, const FilterColumns &columns) const {
+    const FilterColumn &column = columns[col];
+    if (!column.numerical) return cmp_->Matches(column.text[row]);
+    return cmp_->MatchesNumber(column.numbers[row], column.text[row]);
   }
+  virtual void columns(QSet<int> *columns) const { columns->insert(col); }
   virtual FilterType type() { return Column; }
  private:
   int col;
@@ -217,9 +256,10 @@ class NotFilter : public FilterTree {
  public:
   explicit NotFilter(const FilterTree *inv) : child_(inv) {}
 
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const {
-    return !child_->accept(row, parent, model);
+  virtual bool accept(int row, const FilterColumns &columns) const {
+    return !child_->accept(row, columns);
   }
+  virtual void columns(QSet<int> *columns) const { child_->columns(columns); }
   virtual FilterType type() { return Not; }
  private:
   QScopedPointer<const FilterTree> child_;
@@ -229,12 +269,15 @@ class OrFilter : public FilterTree {
  public:
   ~OrFilter() { qDeleteAll(children_); }
   virtual void add(FilterTree *child) { children_.append(child); }
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const {
+  virtual bool accept(int row, const FilterColumns &columns) const {
     for (FilterTree *child : children_) {
-      if (child->accept(row, parent, model)) return true;
+      if (child->accept(row, columns)) return true;
     }
     return false;
   }
+  virtual void columns(QSet<int> *columns) const {
+    for (FilterTree *child : children_) child->columns(columns);
+  }
   FilterType type() { return Or; }
  private:
   QList<FilterTree*> children_;
@@ -244,12 +287,15 @@ class AndFilter : public FilterTree {
  public:
   virtual ~AndFilter() { qDeleteAll(children_); }
   virtual void add(FilterTree *child) { children_.append(child); }
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const {
+  virtual bool accept(int row, const FilterColumns &columns) const {
     for (FilterTree *child : children_) {
-      if (!child->accept(row, parent, model)) return false;
+      if (!child->accept(row, columns)) return false;
     }
     return true;
   }
+  virtual void columns(QSet<int> *columns) const {
+    for (FilterTree *child : children_) child->columns(columns);
+  }
   FilterType type() { return And; }
  private:
   QList<FilterTree*> children_;
@@ -462,8 +508,7 @@ FilterTree *FilterParser::createSearchTermTreeNode(
       cmp = new LeComparator(search_value);
     }
     else {
-      // convert back because for time/rating
-      cmp = new EqComparator(QString::number(search_value));
+      cmp = new NumericalEqComparator(search_value);
     }
   }
   else {
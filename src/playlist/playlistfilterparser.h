@@ -25,18 +25,32 @@
 
 #include <stdbool.h>
 
+#include <QtGlobal>
 #include <QMap>
 #include <QSet>
+#include <QVector>
 #include <QString>
-#include <QAbstractItemModel>
 
-class QModelIndex;
+// Values of one playlist column, extracted once from the playlist items so the filter doesn't need to go through the model for every row.
+// The text is lowercased, numerical columns also keep the value as a number.
+struct FilterColumn {
+  FilterColumn() : numerical(false) {}
+
+  bool numerical;
+  QVector<QString> text;
+  QVector<qint64> numbers;
+};
+
+// Indexed by Playlist::Column, only the columns used by the filter are filled in.
+typedef QVector<FilterColumn> FilterColumns;
 
 // structure for filter parse tree
 class FilterTree {
  public:
   virtual ~FilterTree() {}
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const = 0;
+  virtual bool accept(int row, const FilterColumns &columns) const = 0;
+  // Adds the columns this filter needs to look at.
+  virtual void columns(QSet<int> *columns) const { Q_UNUSED(columns); }
   enum FilterType {
     Nop = 0,
     Or,
@@ -51,7 +65,7 @@ class FilterTree {
 // trivial filter that accepts *anything*
 class NopFilter : public FilterTree {
  public:
-  virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const { return true; }
+  virtual bool accept(int row, const FilterColumns &columns) const { return true; }
   virtual FilterType type() { return Nop; }
 };
 
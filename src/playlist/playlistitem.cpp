@@ -72,6 +72,17 @@ void PlaylistItem::BindToQuery(QSqlQuery *query) const {
 
 }
 
+bool PlaylistItem::IsReferenceOnly() const {
+  return source() == Song::Source_Collection && DatabaseValue(Column_CollectionId).toInt() > 0;
+}
+
+void PlaylistItem::BindReferenceToQuery(QSqlQuery *query) const {
+
+  query->bindValue(":type", source());
+  query->bindValue(":collection_id", DatabaseValue(Column_CollectionId));
+
+}
+
 void PlaylistItem::SetTemporaryMetadata(const Song &metadata) {
   temp_metadata_ = metadata;
 }
@@ -72,6 +72,9 @@ class PlaylistItem : public std::enable_shared_from_this<PlaylistItem> {
 
   virtual bool InitFromQuery(const SqlRow &query) = 0;
   void BindToQuery(QSqlQuery* query) const;
+  // Items pointing to a song in the collection are saved as a reference to it only, the metadata is read from the songs table when loading.
+  bool IsReferenceOnly() const;
+  void BindReferenceToQuery(QSqlQuery *query) const;
   virtual void Reload() {}
   QFuture<void> BackgroundReload();
 
@@ -32,6 +32,8 @@
 #include <QFileInfo>
 #include <QList>
 #include <QSet>
+#include <QHash>
+#include <QDateTime>
 #include <QVariant>
 #include <QString>
 #include <QStringBuilder>
@@ -39,26 +41,34 @@
 #include <QUrl>
 #include <QAbstractItemModel>
 #include <QSettings>
+#include <QTimer>
 #include <QtDebug>
 
 #include "core/application.h"
 #include "core/closure.h"
 #include "core/logging.h"
 #include "core/player.h"
+#include "core/taskmanager.h"
 #include "core/utilities.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionplaylistitem.h"
 #include "playlist.h"
 #include "playlistbackend.h"
 #include "playlistcontainer.h"
+#include "playlistduplicatefinder.h"
 #include "playlistmanager.h"
 #include "playlistitem.h"
 #include "playlistview.h"
 #include "playlistsaveoptionsdialog.h"
+#include "smartplaylistsearch.h"
 #include "playlistparsers/playlistparser.h"
 
 class ParserBase;
 
+const int PlaylistManager::kUnloadCheckIntervalMsec = 60000;
+const qint64 PlaylistManager::kUnloadIdleMsec = 15 * 60000;
+const int PlaylistManager::kSmartPlaylistRefreshIntervalMsec = 60 * 60000;
+
 PlaylistManager::PlaylistManager(Application *app, QObject *parent)
     : PlaylistManagerInterface(app, parent),
       app_(app),
@@ -68,11 +78,22 @@ PlaylistManager::PlaylistManager(Application *app, QObject *parent)
       parser_(nullptr),
       playlist_container_(nullptr),
       current_(-1),
-      active_(-1)
+      active_(-1),
+      remove_duplicates_running_(false),
+      unload_timer_(new QTimer(this)),
+      smart_refresh_timer_(new QTimer(this))
 {
   connect(app_->player(), SIGNAL(Paused()), SLOT(SetActivePaused()));
   connect(app_->player(), SIGNAL(Playing()), SLOT(SetActivePlaying()));
   connect(app_->player(), SIGNAL(Stopped()), SLOT(SetActiveStopped()));
+
+  unload_timer_->setInterval(kUnloadCheckIntervalMsec);
+  connect(unload_timer_, SIGNAL(timeout()), SLOT(UnloadIdlePlaylists()));
+  unload_timer_->start();
+
+  smart_refresh_timer_->setInterval(kSmartPlaylistRefreshIntervalMsec);
+  connect(smart_refresh_timer_, SIGNAL(timeout()), SLOT(RefreshTimeRelativeSmartPlaylists()));
+  smart_refresh_timer_->start();
 }
 
 PlaylistManager::~PlaylistManager() {
@@ -87,12 +108,16 @@ void PlaylistManager::Init(CollectionBackend *collection_backend, PlaylistBacken
   playlist_backend_ = playlist_backend;
   sequence_ = sequence;
   parser_ = new PlaylistParser(collection_backend, this);
+  parser_->set_task_manager(app_->task_manager());
   playlist_container_ = playlist_container;
 
   connect(collection_backend_, SIGNAL(SongsDiscovered(SongList)), SLOT(SongsDiscovered(SongList)));
+  connect(collection_backend_, SIGNAL(SongsDeleted(SongList)), SLOT(SongsDeleted(SongList)));
+  connect(collection_backend_, SIGNAL(SongsStatisticsChanged(SongList)), SLOT(SongsDiscovered(SongList)));
 
   for (const PlaylistBackend::Playlist &p : playlist_backend->GetAllOpenPlaylists()) {
     AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
+    AddSmartPlaylist(p);
   }
 
   // If no playlist exists then make a new one
@@ -128,6 +153,7 @@ Playlist *PlaylistManager::AddPlaylist(int id, const QString &name, const QStrin
   connect(ret, SIGNAL(CurrentSongChanged(Song)), SIGNAL(CurrentSongChanged(Song)));
   connect(ret, SIGNAL(PlaylistChanged()), SLOT(OneOfPlaylistsChanged()));
   connect(ret, SIGNAL(PlaylistChanged()), SLOT(UpdateSummaryText()));
+  connect(ret, SIGNAL(SummaryChanged()), SLOT(UpdateSummaryText()));
   connect(ret, SIGNAL(EditingFinished(QModelIndex)), SIGNAL(EditingFinished(QModelIndex)));
   connect(ret, SIGNAL(Error(QString)), SIGNAL(Error(QString)));
   connect(ret, SIGNAL(PlayRequested(QModelIndex)), SIGNAL(PlayRequested(QModelIndex)));
@@ -168,6 +194,114 @@ void PlaylistManager::New(const QString &name, const SongList &songs, const QStr
 
 }
 
+void PlaylistManager::NewSmartPlaylist(const QString &name, const SmartPlaylistSearch &search) {
+
+  if (name.isNull() || !search.is_valid()) return;
+
+  PlaylistBackend::Playlist p;
+  p.name = name;
+  p.special_type = SmartPlaylistSearch::kSpecialType;
+  p.smart_playlist_data = search.Serialise();
+  p.id = playlist_backend_->CreatePlaylist(p.name, p.special_type);
+
+  if (p.id == -1) {
+    emit Error(tr("Couldn't create playlist"));
+    return;
+  }
+
+  playlist_backend_->SetSmartPlaylistData(p.id, p.smart_playlist_data);
+
+  // The songs are added when the new, empty playlist has been restored.
+  AddPlaylist(p.id, p.name, p.special_type, QString(), false);
+  AddSmartPlaylist(p);
+
+  SetCurrentPlaylist(p.id);
+
+}
+
+void PlaylistManager::AddSmartPlaylist(const PlaylistBackend::Playlist &p) {
+
+  if (p.special_type != SmartPlaylistSearch::kSpecialType) return;
+
+  SmartPlaylist smart;
+  smart.search = SmartPlaylistSearch::Deserialise(p.smart_playlist_data);
+  if (!smart.search.is_valid()) {
+    qLog(Warning) << "Invalid smart playlist" << p.name;
+    return;
+  }
+  smart_playlists_[p.id] = smart;
+
+  // Refresh the songs whenever the playlist is restored, the collection might have changed while it wasn't loaded.
+  connect(playlist(p.id), SIGNAL(RestoreFinished()), SLOT(SmartPlaylistRestored()));
+
+}
+
+void PlaylistManager::SmartPlaylistRestored() {
+
+  Playlist *playlist = qobject_cast<Playlist*>(sender());
+  if (!playlist || !smart_playlists_.contains(playlist->id())) return;
+
+  // Which songs were added by the search isn't saved, so the refresh may remove any collection song in the playlist.
+  playlist->MarkCollectionItemsGenerated();
+  RefreshSmartPlaylist(playlist->id());
+
+}
+
+void PlaylistManager::RefreshTimeRelativeSmartPlaylists() {
+
+  for (QMap<int, SmartPlaylist>::const_iterator it = smart_playlists_.constBegin() ; it != smart_playlists_.constEnd() ; ++it) {
+    // Playlists that aren't restored are refreshed when they are.
+    if (it->search.is_time_relative() && playlists_[it.key()].p->is_restored()) RefreshSmartPlaylist(it.key());
+  }
+
+}
+
+void PlaylistManager::RefreshSmartPlaylist(int id) {
+
+  SmartPlaylist &smart = smart_playlists_[id];
+  if (smart.refreshing) return;
+
+  smart.refreshing = true;
+  smart.changed_while_refreshing.clear();
+
+  QFuture<SongList> future = QtConcurrent::run(smart.search, &SmartPlaylistSearch::Run, collection_backend_);
+  NewClosure(future, this, SLOT(SmartPlaylistSearchFinished(QFuture<SongList>, int)), future, id);
+
+}
+
+void PlaylistManager::SmartPlaylistSearchFinished(QFuture<SongList> future, int id) {
+
+  // The playlist might have been closed in the meantime.
+  if (!smart_playlists_.contains(id) || !playlists_.contains(id)) return;
+
+  SmartPlaylist &smart = smart_playlists_[id];
+  const QHash<int, bool> changed = smart.changed_while_refreshing;
+  smart.refreshing = false;
+  smart.changed_while_refreshing.clear();
+
+  Playlist *playlist = playlists_[id].p;
+  if (!playlist->is_restored()) return;
+
+  // Add the songs that aren't in the playlist yet, and remove the collection items that aren't in the result.
+  QSet<int> result_ids;
+  SongList added;
+  for (const Song &song : future.result()) {
+    if (!changed.value(song.id(), true)) continue;
+    result_ids << song.id();
+    if (playlist->collection_items_by_id(song.id()).isEmpty()) added << song;
+  }
+
+  QSet<int> removed_ids;
+  for (PlaylistItemPtr item : playlist->GetAllItems()) {
+    if (item->source() != Song::Source_Collection) continue;
+    const int song_id = item->Metadata().id();
+    if (!result_ids.contains(song_id) && !changed.value(song_id, false)) removed_ids << song_id;
+  }
+
+  playlist->UpdateGeneratedItems(added, removed_ids);
+
+}
+
 void PlaylistManager::Load(const QString &filename) {
 
   QFileInfo info(filename);
@@ -188,21 +322,29 @@ void PlaylistManager::Load(const QString &filename) {
 
 void PlaylistManager::Save(int id, const QString &filename, Playlist::Path path_type) {
 
-  if (playlists_.contains(id)) {
-    parser_->Save(playlist(id)->GetAllSongs(), filename, path_type);
+  // Writing large playlists takes a while, so it's done in the background.
+  QFuture<bool> future;
+  if (playlists_.contains(id) && playlist(id)->is_restored()) {
+    future = QtConcurrent::run(parser_, &PlaylistParser::Save, playlist(id)->GetAllSongs(), filename, path_type);
   }
   else {
-    // Playlist is not in the playlist manager: probably save action was triggered from the left side bar and the playlist isn't loaded.
-    QFuture<QList<Song>> future = QtConcurrent::run(playlist_backend_, &PlaylistBackend::GetPlaylistSongs, id);
-
-    NewClosure(future, this, SLOT(ItemsLoadedForSavePlaylist(QFuture<SongList>, QString, Playlist::Path)), future, filename, path_type);
+    // Playlist is not in the playlist manager or not restored yet: probably save action was triggered from the left side bar and the playlist isn't loaded.
+    future = QtConcurrent::run(this, &PlaylistManager::LoadAndSavePlaylist, id, filename, path_type);
   }
 
+  NewClosure(future, this, SLOT(SavePlaylistFinished(QFuture<bool>, QString)), future, filename);
+
 }
 
-void PlaylistManager::ItemsLoadedForSavePlaylist(QFuture<SongList> future, const QString &filename, Playlist::Path path_type) {
+bool PlaylistManager::LoadAndSavePlaylist(int id, const QString &filename, Playlist::Path path_type) const {
+  return parser_->Save(playlist_backend_->GetPlaylistSongs(id), filename, path_type);
+}
 
-  parser_->Save(future.result(), filename, path_type);
+void PlaylistManager::SavePlaylistFinished(QFuture<bool> future, const QString &filename) {
+
+  if (!future.result()) {
+    emit Error(tr("Couldn't save playlist %1").arg(filename));
+  }
 
 }
 
@@ -318,14 +460,22 @@ bool PlaylistManager::Close(int id) {
   if (id == current_) SetCurrentPlaylist(next_id);
 
   Data data = playlists_.take(id);
+  smart_playlists_.remove(id);
   emit PlaylistClosed(id);
 
   if (!data.p->is_favorite()) {
     playlist_backend_->RemovePlaylist(id);
     emit PlaylistDeleted(id);
   }
+  // Favorites stay in the database, but the saved rows are only needed while the playlist is open.
+  playlist_backend_->ForgetSavedRowsAsync(id);
   delete data.p;
 
+  // A closed playlist won't finish restoring, so RemoveDuplicatesAll() shouldn't wait for it.
+  if (remove_duplicates_restoring_.remove(id) && remove_duplicates_restoring_.isEmpty()) {
+    FindDuplicatesAll();
+  }
+
   return true;
 
 }
@@ -348,7 +498,9 @@ void PlaylistManager::OneOfPlaylistsChanged() {
 void PlaylistManager::SetCurrentPlaylist(int id) {
 
   Q_ASSERT(playlists_.contains(id));
+  if (current_ != -1 && playlists_.contains(current_)) playlists_[current_].last_seen.restart();
   current_ = id;
+  current()->RestoreIfNeeded();
   emit CurrentChanged(current());
   UpdateSummaryText();
 
@@ -361,8 +513,10 @@ void PlaylistManager::SetActivePlaylist(int id) {
   // Kinda a hack: unset the current item from the old active playlist before
   // setting the new one
   if (active_ != -1 && active_ != id) active()->set_current_row(-1);
+  if (active_ != -1 && playlists_.contains(active_)) playlists_[active_].last_seen.restart();
 
   active_ = id;
+  active()->RestoreIfNeeded();
   emit ActiveChanged(active());
 
 }
@@ -390,6 +544,88 @@ void PlaylistManager::RemoveDuplicatesCurrent() {
   current()->RemoveDuplicateSongs();
 }
 
+void PlaylistManager::RemoveDuplicatesAll() {
+
+  // The one already running covers the same playlists.
+  if (remove_duplicates_running_) return;
+  remove_duplicates_running_ = true;
+
+  // Playlists that aren't restored have no items, restore them first and continue when they are all done.
+  remove_duplicates_restoring_.clear();
+  for (const Data &data : playlists_) {
+    if (data.p->is_restored()) continue;
+    data.p->RestoreIfNeeded();
+    if (!data.p->is_restoring()) continue;
+    connect(data.p, SIGNAL(RestoreFinished()), SLOT(RemoveDuplicatesAllRestored()), Qt::UniqueConnection);
+    remove_duplicates_restoring_ << data.p->id();
+  }
+  if (remove_duplicates_restoring_.isEmpty()) FindDuplicatesAll();
+
+}
+
+void PlaylistManager::RemoveDuplicatesAllRestored() {
+
+  Playlist *playlist = qobject_cast<Playlist*>(sender());
+  if (!playlist) return;
+
+  disconnect(playlist, SIGNAL(RestoreFinished()), this, SLOT(RemoveDuplicatesAllRestored()));
+
+  if (remove_duplicates_restoring_.remove(playlist->id()) && remove_duplicates_restoring_.isEmpty()) {
+    FindDuplicatesAll();
+  }
+
+}
+
+void PlaylistManager::FindDuplicatesAll() {
+
+  // The current playlist goes first so its songs are the ones that are kept.
+  // Playlists that couldn't be restored have no items and are left out.
+  QList<int> ids;
+  ids << current_id();
+  for (int id : playlists_.keys()) {
+    if (id != current_id() && playlists_[id].p->is_restored()) ids << id;
+  }
+
+  QList<PlaylistItemList> items;
+  QList<SongList> songs;
+  for (int id : ids) {
+    Playlist *playlist = playlists_[id].p;
+    items << playlist->GetAllItems();
+    songs << playlist->GetAllSongs();
+  }
+
+  const int task_id = app_->task_manager()->StartTask(tr("Removing duplicates"));
+  QFuture<QList<QList<int>>> future = QtConcurrent::run(&PlaylistDuplicateFinder::Find, songs, PlaylistDuplicateFinder::Mode_SameFile, app_->task_manager(), task_id);
+  NewClosure(future, this, SLOT(RemoveDuplicatesAllFinished(QFuture<QList<QList<int>>>, QList<int>, QList<PlaylistItemList>, int)), future, ids, items, task_id);
+
+}
+
+void PlaylistManager::RemoveDuplicatesAllFinished(QFuture<QList<QList<int>>> future, const QList<int> &ids, const QList<PlaylistItemList> &items, int task_id) {
+
+  const QList<QList<int>> duplicates = future.result();
+
+  for (int i = 0 ; i < ids.count() ; ++i) {
+    if (duplicates[i].isEmpty() || !playlists_.contains(ids[i])) continue;
+
+    // The playlist can have changed while the duplicates were searched for, so find the rows of the items again.
+    QSet<const PlaylistItem*> duplicate_items;
+    for (int index : duplicates[i]) {
+      duplicate_items << items[i][index].get();
+    }
+
+    Playlist *playlist = playlists_[ids[i]].p;
+    QList<int> rows;
+    for (int row = 0 ; row < playlist->rowCount() ; ++row) {
+      if (duplicate_items.contains(playlist->item_at(row).get())) rows << row;
+    }
+    playlist->removeRows(rows);
+  }
+
+  app_->task_manager()->SetTaskFinished(task_id);
+  remove_duplicates_running_ = false;
+
+}
+
 void PlaylistManager::RemoveUnavailableCurrent() {
   current()->RemoveUnavailableSongs();
 }
@@ -404,9 +640,31 @@ void PlaylistManager::ChangePlaylistOrder(const QList<int> &ids) {
   playlist_backend_->SetPlaylistOrder(ids);
 }
 
+void PlaylistManager::UnloadIdlePlaylists() {
+
+  // RemoveDuplicatesAll() needs the items of all playlists until it's done.
+  if (remove_duplicates_running_) return;
+
+  for (QMap<int, Data>::iterator it = playlists_.begin() ; it != playlists_.end() ; ++it) {
+    if (it.key() == current_ || it.key() == active_) continue;
+    if (!it->p->is_restored() || it->last_seen.elapsed() < kUnloadIdleMsec) continue;
+
+    if (it->p->Unload()) {
+      qLog(Debug) << "Unloaded idle playlist" << it->name;
+      it->selection = QItemSelection();
+    }
+  }
+
+}
+
 void PlaylistManager::UpdateSummaryText() {
 
-  int tracks = current()->rowCount();
+  // While the playlist is being restored, show the size of the whole playlist.
+  const bool restored = current()->is_restored();
+  PlaylistBackend::PlaylistSummary playlist_summary;
+  if (!restored) playlist_summary = current()->GetSummary();
+
+  int tracks = restored ? current()->rowCount() : playlist_summary.count;
   quint64 nanoseconds = 0;
   int selected = 0;
 
@@ -426,7 +684,7 @@ void PlaylistManager::UpdateSummaryText() {
   if (selected > 1) {
     summary += tr("%1 selected of").arg(selected) + " ";
   } else {
-    nanoseconds = current()->GetTotalLength();
+    nanoseconds = restored ? current()->GetTotalLength() : playlist_summary.length_nanosec;
   }
 
   // TODO: Make the plurals translatable
@@ -446,17 +704,46 @@ void PlaylistManager::SelectionChanged(const QItemSelection &selection) {
 
 void PlaylistManager::SongsDiscovered(const SongList &songs) {
 
-  // Some songs might've changed in the collection, let's update any playlist items we have that match those songs
+  // Some songs might've changed in the collection, let's update any playlist items we have that match those songs.
+  // Each playlist looks up the items in its ID index and updates all of them at once.
 
-  for (const Song &song : songs) {
-    for (const Data &data : playlists_) {
-      PlaylistItemList items = data.p->collection_items_by_id(song.id());
-      for (PlaylistItemPtr item : items) {
-        if (item->Metadata().directory_id() != song.directory_id()) continue;
-        static_cast<CollectionPlaylistItem*>(item.get())->SetMetadata(song);
-        data.p->ItemChanged(item);
-      }
+  for (const Data &data : playlists_) {
+    data.p->UpdateCollectionItems(songs);
+  }
+
+  UpdateSmartPlaylists(songs, false);
+
+}
+
+void PlaylistManager::SongsDeleted(const SongList &songs) {
+  UpdateSmartPlaylists(songs, true);
+}
+
+void PlaylistManager::UpdateSmartPlaylists(const SongList &songs, bool deleted) {
+
+  // Instead of running the searches again, match only the changed songs against them.
+  const uint now = QDateTime::currentDateTime().toTime_t();
+
+  for (QMap<int, SmartPlaylist>::iterator it = smart_playlists_.begin() ; it != smart_playlists_.end() ; ++it) {
+    Playlist *playlist = playlists_[it.key()].p;
+
+    // Playlists that aren't restored are refreshed when they are.
+    const bool restored = playlist->is_restored();
+    if (!restored && !it->refreshing) continue;
+
+    SongList added;
+    QSet<int> removed_ids;
+    for (const Song &song : songs) {
+      const bool matches = !deleted && it->search.Matches(song, now);
+      if (it->refreshing) it->changed_while_refreshing[song.id()] = matches;
+      if (!restored) continue;
+
+      const bool present = !playlist->collection_items_by_id(song.id()).isEmpty();
+      if (matches && !present) added << song;
+      else if (!matches && present) removed_ids << song.id();
     }
+
+    if (restored) playlist->UpdateGeneratedItems(added, removed_ids);
   }
 
 }
@@ -562,6 +849,7 @@ void PlaylistManager::Open(int id) {
   }
 
   AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
+  AddSmartPlaylist(p);
 
 }
 
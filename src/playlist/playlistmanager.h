@@ -28,7 +28,10 @@
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QFuture>
+#include <QElapsedTimer>
 #include <QString>
 #include <QUrl>
 #include <QModelIndex>
@@ -36,6 +39,7 @@
 
 #include "core/song.h"
 #include "playlist.h"
+#include "smartplaylistsearch.h"
 
 class Application;
 class CollectionBackend;
@@ -43,6 +47,7 @@ class PlaylistBackend;
 class PlaylistContainer;
 class PlaylistParser;
 class PlaylistSequence;
+class QTimer;
 
 class PlaylistManagerInterface : public QObject {
   Q_OBJECT
@@ -98,6 +103,7 @@ public slots:
   virtual void ClearCurrent() = 0;
   virtual void ShuffleCurrent() = 0;
   virtual void RemoveDuplicatesCurrent() = 0;
+  virtual void RemoveDuplicatesAll() = 0;
   virtual void RemoveUnavailableCurrent() = 0;
   virtual void SetActivePlaying() = 0;
   virtual void SetActivePaused() = 0;
@@ -133,6 +139,10 @@ class PlaylistManager : public PlaylistManagerInterface {
   PlaylistManager(Application *app, QObject *parent = nullptr);
   ~PlaylistManager();
 
+  static const int kUnloadCheckIntervalMsec;
+  static const qint64 kUnloadIdleMsec;
+  static const int kSmartPlaylistRefreshIntervalMsec;
+
   int current_id() const { return current_; }
   int active_id() const { return active_; }
 
@@ -169,6 +179,8 @@ class PlaylistManager : public PlaylistManagerInterface {
 
 public slots:
   void New(const QString &name, const SongList &songs = SongList(), const QString &special_type = QString());
+  // Creates a playlist that is filled with the collection songs matching the search, and kept up to date when the collection changes.
+  void NewSmartPlaylist(const QString &name, const SmartPlaylistSearch &search);
   void Load(const QString &filename);
   void Save(int id, const QString &filename, Playlist::Path path_type);
   // Display a file dialog to let user choose a file before saving the file
@@ -193,6 +205,8 @@ public slots:
   void ClearCurrent();
   void ShuffleCurrent();
   void RemoveDuplicatesCurrent();
+  // Removes songs that are in more than one of the open playlists, keeping them in the current playlist first.
+  void RemoveDuplicatesAll();
   void RemoveUnavailableCurrent();
   //void SetActiveStreamMetadata(const QUrl& url, const Song& song);
 
@@ -213,17 +227,46 @@ public slots:
   void OneOfPlaylistsChanged();
   void UpdateSummaryText();
   void SongsDiscovered(const SongList& songs);
-  void ItemsLoadedForSavePlaylist(QFuture<SongList> future, const QString& filename, Playlist::Path path_type);
+  void SongsDeleted(const SongList& songs);
+  void SmartPlaylistRestored();
+  void SmartPlaylistSearchFinished(QFuture<SongList> future, int id);
+  void SavePlaylistFinished(QFuture<bool> future, const QString &filename);
+  // Continues RemoveDuplicatesAll() once all the playlists it restores are done.
+  void RemoveDuplicatesAllRestored();
+  void RemoveDuplicatesAllFinished(QFuture<QList<QList<int>>> future, const QList<int> &ids, const QList<PlaylistItemList> &items, int task_id);
+  // Releases the items of playlists that haven't been current or active for a while.
+  void UnloadIdlePlaylists();
+  // Runs the searches of smart playlists with date rules again, songs can move in or out of "the last days" without changing.
+  void RefreshTimeRelativeSmartPlaylists();
 
  private:
   Playlist *AddPlaylist(int id, const QString& name, const QString &special_type, const QString& ui_path, bool favorite);
+  // Reads the songs of a playlist that isn't loaded from the database and saves them.  Runs in a worker thread.
+  bool LoadAndSavePlaylist(int id, const QString &filename, Playlist::Path path_type) const;
+  void AddSmartPlaylist(const PlaylistBackend::Playlist &p);
+  // Runs the search of a smart playlist again in the background and adds or removes the songs that changed.
+  void RefreshSmartPlaylist(int id);
+  // Applies songs that were changed or deleted in the collection to the smart playlists.
+  void UpdateSmartPlaylists(const SongList &songs, bool deleted);
+  // Starts searching for the duplicates of RemoveDuplicatesAll() in the restored playlists.
+  void FindDuplicatesAll();
 
 private:
   struct Data {
-    Data(Playlist *_p = nullptr, const QString& _name = QString()) : p(_p), name(_name) {}
+    Data(Playlist *_p = nullptr, const QString& _name = QString()) : p(_p), name(_name) { last_seen.start(); }
     Playlist *p;
     QString name;
     QItemSelection selection;
+    // Time since the playlist was last current or active.
+    QElapsedTimer last_seen;
+  };
+
+  struct SmartPlaylist {
+    SmartPlaylist() : refreshing(false) {}
+    SmartPlaylistSearch search;
+    bool refreshing;
+    // Whether songs changed while the search was running match now, these override the result of the search.
+    QHash<int, bool> changed_while_refreshing;
   };
 
   Application *app_;
@@ -235,9 +278,18 @@ private:
 
   // key = id
   QMap<int, Data> playlists_;
+  QMap<int, SmartPlaylist> smart_playlists_;
 
   int current_;
   int active_;
+
+  // Playlists RemoveDuplicatesAll() is waiting for to be restored.
+  QSet<int> remove_duplicates_restoring_;
+  // Set from RemoveDuplicatesAll() until the duplicates are removed, no playlists are unloaded in between.
+  bool remove_duplicates_running_;
+
+  QTimer *unload_timer_;
+  QTimer *smart_refresh_timer_;
 };
 
 #endif  // PLAYLISTMANAGER_H
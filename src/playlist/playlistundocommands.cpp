@@ -23,16 +23,64 @@
 #include <memory>
 
 #include <QList>
+#include <QVector>
 #include <QUrl>
 #include <QUndoStack>
 
 #include "core/song.h"
+#include "collection/collectionplaylistitem.h"
 #include "playlist.h"
 #include "playlistitem.h"
 #include "playlistundocommands.h"
 
 namespace PlaylistUndoCommands {
 
+const int RemovedItems::kKeepItemsLimit = 5000;
+
+RemovedItems::RemovedItems(const PlaylistItemList &items) {
+
+  if (items.count() <= kKeepItemsLimit) {
+    items_ = items.toVector();
+    return;
+  }
+
+  collection_ids_.reserve(items.count());
+  for (PlaylistItemPtr item : items) {
+    // Temporary metadata would be lost if the item was created again.
+    if (item->IsReferenceOnly() && !item->HasTemporaryMetadata()) {
+      collection_ids_ << item->Metadata().id();
+    }
+    else {
+      collection_ids_ << -1;
+      items_ << item;
+    }
+  }
+
+}
+
+PlaylistItemList RemovedItems::Restore() const {
+
+  if (collection_ids_.isEmpty()) return items_.toList();
+
+  PlaylistItemList ret;
+  ret.reserve(collection_ids_.count());
+  int item = 0;
+  for (int id : collection_ids_) {
+    if (id == -1) {
+      ret << items_[item++];
+    }
+    else {
+      // Only the ID is known until the song is read from the collection.
+      Song song;
+      song.set_id(id);
+      ret << PlaylistItemPtr(new CollectionPlaylistItem(song));
+    }
+  }
+
+  return ret;
+
+}
+
 Base::Base(Playlist* playlist) : QUndoCommand(0), playlist_(playlist) {}
 
 
@@ -40,18 +88,19 @@ InsertItems::InsertItems(Playlist *playlist, const PlaylistItemList &items, int
   : Base(playlist),
     items_(items),
     pos_(pos),
+    start_(pos),
     enqueue_(enqueue)
 {
   setText(tr("add %n songs", "", items_.count()));
 }
 
 void InsertItems::redo() {
+  start_ = pos_ == -1 ? playlist_->rowCount() : pos_;
   playlist_->InsertItemsWithoutUndo(items_, pos_, enqueue_);
 }
 
 void InsertItems::undo() {
-  const int start = pos_ == -1 ? playlist_->rowCount() - items_.count() : pos_;
-  playlist_->RemoveItemsWithoutUndo(start, items_.count());
+  playlist_->RemoveItemsWithoutUndo(start_, items_.count());
 }
 
 bool InsertItems::UpdateItem(const PlaylistItemPtr &updated_item) {
@@ -74,12 +123,15 @@ RemoveItems::RemoveItems(Playlist *playlist, int pos, int count) : Base(playlist
 
 void RemoveItems::redo() {
   for (int i = 0; i < ranges_.count(); ++i)
-    ranges_[i].items_ = playlist_->RemoveItemsWithoutUndo(ranges_[i].pos_, ranges_[i].count_);
+    ranges_[i].items_ = RemovedItems(playlist_->RemoveItemsWithoutUndo(ranges_[i].pos_, ranges_[i].count_));
 }
 
 void RemoveItems::undo() {
-  for (int i = ranges_.count() - 1; i >= 0; --i)
-    playlist_->InsertItemsWithoutUndo(ranges_[i].items_, ranges_[i].pos_);
+  for (int i = ranges_.count() - 1; i >= 0; --i) {
+    const PlaylistItemList items = ranges_[i].items_.Restore();
+    playlist_->InsertItemsWithoutUndo(items, ranges_[i].pos_);
+    playlist_->LoadCollectionItemsAsync(items);
+  }
 }
 
 bool RemoveItems::mergeWith(const QUndoCommand *other) {
@@ -110,15 +162,39 @@ void MoveItems::undo() {
   playlist_->MoveItemsWithoutUndo(pos_, source_rows_);
 }
 
-ReOrderItems::ReOrderItems(Playlist* playlist, const PlaylistItemList &new_items)
-    : Base(playlist), old_items_(playlist->items_), new_items_(new_items) {}
+ReOrderItems::ReOrderItems(Playlist* playlist, const QVector<int> &new_rows)
+    : Base(playlist), old_items_(playlist->items_) {
+
+  new_items_.reserve(new_rows.count());
+  for (int row : new_rows) {
+    new_items_ << old_items_[row];
+  }
+
+}
+
+void ReOrderItems::undo() {
+  Apply(new_items_, old_items_);
+}
+
+void ReOrderItems::redo() {
+  Apply(old_items_, new_items_);
+}
+
+void ReOrderItems::Apply(const PlaylistItemList &from_items, const PlaylistItemList &to_items) {
+
+  // Rows can have been removed without undo since, for example by removing duplicates.  Don't reorder items that aren't there anymore.
+  const PlaylistItemList &items = playlist_->items_;
+  if (items.count() < from_items.count()) return;
+  for (int i = 0; i < from_items.count(); ++i) {
+    if (items[i] != from_items[i]) return;
+  }
 
-void ReOrderItems::undo() { playlist_->ReOrderWithoutUndo(old_items_); }
+  playlist_->ReOrderWithoutUndo(to_items + items.mid(from_items.count()));
 
-void ReOrderItems::redo() { playlist_->ReOrderWithoutUndo(new_items_); }
+}
 
-SortItems::SortItems(Playlist* playlist, int column, Qt::SortOrder order, const PlaylistItemList &new_items)
-  : ReOrderItems(playlist, new_items)
+SortItems::SortItems(Playlist* playlist, int column, Qt::SortOrder order, const QVector<int> &new_rows)
+  : ReOrderItems(playlist, new_rows)
     //column_(column),
     //order_(order)
 {
@@ -126,8 +202,8 @@ SortItems::SortItems(Playlist* playlist, int column, Qt::SortOrder order, const
 }
 
 
-ShuffleItems::ShuffleItems(Playlist* playlist, const PlaylistItemList &new_items)
-  : ReOrderItems(playlist, new_items)
+ShuffleItems::ShuffleItems(Playlist* playlist, const QVector<int> &new_rows)
+  : ReOrderItems(playlist, new_rows)
 {
   setText(tr("shuffle songs"));
 }
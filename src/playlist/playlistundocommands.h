@@ -27,6 +27,7 @@
 
 #include <QCoreApplication>
 #include <QList>
+#include <QVector>
 #include <QUndoStack>
 
 #include "playlistitem.h"
@@ -39,6 +40,24 @@ namespace PlaylistUndoCommands {
     Type_RemoveItems = 0,
   };
 
+  // Items removed from a playlist.  Up to kKeepItemsLimit items are kept as they are, larger ranges are kept as compact as possible until they're put back:
+  // items that only reference a collection song are stored as the song ID and put back without metadata, Playlist::LoadCollectionItemsAsync() fills it in.
+  class RemovedItems {
+   public:
+    RemovedItems() {}
+    explicit RemovedItems(const PlaylistItemList &items);
+
+    static const int kKeepItemsLimit;
+
+    int count() const { return collection_ids_.isEmpty() ? items_.count() : collection_ids_.count(); }
+    PlaylistItemList Restore() const;
+
+   private:
+    // Empty if all items are in items_, otherwise one entry per item, -1 for items that are in items_.
+    QVector<int> collection_ids_;
+    QVector<PlaylistItemPtr> items_;
+  };
+
   class Base : public QUndoCommand {
     Q_DECLARE_TR_FUNCTIONS(PlaylistUndoCommands);
 
@@ -63,6 +82,8 @@ namespace PlaylistUndoCommands {
    private:
     PlaylistItemList items_;
     int pos_;
+    // Where the items were inserted, items can be appended without undo after them.
+    int start_;
     bool enqueue_;
   };
 
@@ -81,7 +102,7 @@ namespace PlaylistUndoCommands {
       Range(int pos, int count) : pos_(pos), count_(count) {}
       int pos_;
       int count_;
-      PlaylistItemList items_;
+      RemovedItems items_;
     };
 
     QList<Range> ranges_;
@@ -99,21 +120,26 @@ namespace PlaylistUndoCommands {
     int pos_;
   };
 
+  // The items are stored in both orders, the command is only applied if the playlist still has them in the order it expects.
   class ReOrderItems : public Base {
    public:
-    ReOrderItems(Playlist *playlist, const PlaylistItemList &new_items);
+    // new_rows contains the current row of each item, in the new order.
+    ReOrderItems(Playlist *playlist, const QVector<int> &new_rows);
 
     void undo();
     void redo();
 
    private:
+    // Puts the items in to_items if the playlist starts with from_items.  Rows appended without undo after them are kept at the end.
+    void Apply(const PlaylistItemList &from_items, const PlaylistItemList &to_items);
+
     PlaylistItemList old_items_;
     PlaylistItemList new_items_;
   };
 
   class SortItems : public ReOrderItems {
    public:
-    SortItems(Playlist *playlist, int column, Qt::SortOrder order, const PlaylistItemList &new_items);
+    SortItems(Playlist *playlist, int column, Qt::SortOrder order, const QVector<int> &new_rows);
 
    private:
     //int column_;
@@ -122,7 +148,7 @@ namespace PlaylistUndoCommands {
 
   class ShuffleItems : public ReOrderItems {
    public:
-    ShuffleItems(Playlist *playlist, const PlaylistItemList &new_items);
+    ShuffleItems(Playlist *playlist, const QVector<int> &new_rows);
   };
 } //namespace
 
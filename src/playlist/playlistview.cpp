@@ -31,6 +31,7 @@
 #include <QByteArray>
 #include <QClipboard>
 #include <QCommonStyle>
+#include <QElapsedTimer>
 #include <QFontMetrics>
 #include <QHeaderView>
 #include <QItemSelectionModel>
@@ -66,6 +67,7 @@
 #include <QSettings>
 
 #include "core/application.h"
+#include "core/logging.h"
 #include "core/player.h"
 #include "core/qt_blurimage.h"
 #include "core/song.h"
@@ -85,6 +87,8 @@ const int PlaylistView::kGlowIntensitySteps = 24;
 const int PlaylistView::kAutoscrollGraceTimeout = 30;  // seconds
 const int PlaylistView::kDropIndicatorWidth = 2;
 const int PlaylistView::kDropIndicatorGradientWidth = 5;
+const int PlaylistView::kTextCacheSize = 20000;
+const int PlaylistView::kPaintStatsInterval = 5000;
 const char *PlaylistView::kSettingBackgroundImageType = "playlistview_background_type";
 const char *PlaylistView::kSettingBackgroundImageFilename = "playlistview_background_image_file";
 
@@ -159,7 +163,11 @@ PlaylistView::PlaylistView(QWidget *parent)
       currenttrack_pause_(":/pictures/currenttrack_pause.png"),
       cached_current_row_row_(-1),
       drop_indicator_row_(-1),
-      drag_over_(false)
+      drag_over_(false),
+      text_cache_(kTextCacheSize),
+      paint_frames_(0),
+      paint_nsec_total_(0),
+      paint_nsec_max_(0)
 {
 
   setHeader(header_);
@@ -270,15 +278,29 @@ void PlaylistView::setModel(QAbstractItemModel *m) {
 
   if (model()) {
     disconnect(model(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(InvalidateCachedCurrentPixmap()));
+    disconnect(model(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(TextDataChanged(QModelIndex, QModelIndex)));
+    disconnect(model(), SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(ClearTextCache()));
+    disconnect(model(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(ClearTextCache()));
+    disconnect(model(), SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(ClearTextCache()));
+    disconnect(model(), SIGNAL(layoutChanged()), this, SLOT(ClearTextCache()));
+    disconnect(model(), SIGNAL(modelReset()), this, SLOT(ClearTextCache()));
 
     // When changing the model, always invalidate the current pixmap.
     // If a remote client uses "stop after", without invaliding the stop mark would not appear.
     InvalidateCachedCurrentPixmap();
   }
 
+  ClearTextCache();
+
   QTreeView::setModel(m);
 
   connect(model(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(InvalidateCachedCurrentPixmap()));
+  connect(model(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(TextDataChanged(QModelIndex, QModelIndex)));
+  connect(model(), SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(ClearTextCache()));
+  connect(model(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(ClearTextCache()));
+  connect(model(), SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(ClearTextCache()));
+  connect(model(), SIGNAL(layoutChanged()), this, SLOT(ClearTextCache()));
+  connect(model(), SIGNAL(modelReset()), this, SLOT(ClearTextCache()));
 
 }
 
@@ -383,10 +405,69 @@ QList<QPixmap> PlaylistView::LoadBarPixmap(const QString &filename) {
 
 void PlaylistView::drawTree(QPainter *painter, const QRegion &region) const {
 
+  QElapsedTimer timer;
+  timer.start();
+
   const_cast<PlaylistView*>(this)->current_paint_region_ = region;
   QTreeView::drawTree(painter, region);
   const_cast<PlaylistView*>(this)->current_paint_region_ = QRegion();
 
+  const_cast<PlaylistView*>(this)->UpdatePaintStats(timer.nsecsElapsed());
+
+}
+
+void PlaylistView::UpdatePaintStats(qint64 nsec) {
+
+  ++paint_frames_;
+  paint_nsec_total_ += nsec;
+  paint_nsec_max_ = qMax(paint_nsec_max_, nsec);
+
+  if (!paint_stats_timer_.isValid()) {
+    paint_stats_timer_.start();
+  }
+  else if (paint_stats_timer_.elapsed() >= kPaintStatsInterval) {
+    qLog(Debug) << "Painted" << paint_frames_ << "frames, average" << paint_nsec_total_ / paint_frames_ / 1000 << "usec, slowest" << paint_nsec_max_ / 1000 << "usec," << text_cache_.count() << "cells cached";
+    paint_frames_ = 0;
+    paint_nsec_total_ = 0;
+    paint_nsec_max_ = 0;
+    paint_stats_timer_.restart();
+  }
+
+}
+
+quint64 PlaylistView::TextCacheKey(int row, int column) {
+  return (quint64(row) << 32) | quint32(column);
+}
+
+PlaylistDelegateBase::CachedText *PlaylistView::cached_text(const QModelIndex &index) const {
+  return text_cache_.object(TextCacheKey(index.row(), index.column()));
+}
+
+PlaylistDelegateBase::CachedText *PlaylistView::insert_cached_text(const QModelIndex &index, PlaylistDelegateBase::CachedText *text) const {
+
+  text_cache_.insert(TextCacheKey(index.row(), index.column()), text);
+  return text;
+
+}
+
+void PlaylistView::TextDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right) {
+
+  const int cells = (bottom_right.row() - top_left.row() + 1) * (bottom_right.column() - top_left.column() + 1);
+  if (cells > text_cache_.count()) {
+    text_cache_.clear();
+    return;
+  }
+
+  for (int row = top_left.row() ; row <= bottom_right.row() ; ++row) {
+    for (int column = top_left.column() ; column <= bottom_right.column() ; ++column) {
+      text_cache_.remove(TextCacheKey(row, column));
+    }
+  }
+
+}
+
+void PlaylistView::ClearTextCache() {
+  text_cache_.clear();
 }
 
 void PlaylistView::drawRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
@@ -30,6 +30,8 @@
 #include <QObject>
 #include <QWidget>
 #include <QList>
+#include <QCache>
+#include <QElapsedTimer>
 #include <QString>
 #include <QImage>
 #include <QPixmap>
@@ -51,6 +53,7 @@
 #include <QtEvents>
 
 #include "playlist.h"
+#include "playlistdelegates.h"
 
 class QEvent;
 class QShowEvent;
@@ -120,6 +123,11 @@ class PlaylistView : public QTreeView {
   BackgroundImageType background_image_type() const { return background_image_type_; }
   Qt::Alignment column_alignment(int section) const;
 
+  // Text prepared by the delegates, dropped when the model data of the cell changes.
+  PlaylistDelegateBase::CachedText *cached_text(const QModelIndex &index) const;
+  // Takes ownership of text.
+  PlaylistDelegateBase::CachedText *insert_cached_text(const QModelIndex &index, PlaylistDelegateBase::CachedText *text) const;
+
   // QTreeView
   void drawTree(QPainter *painter, const QRegion &region) const;
   void drawRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
@@ -187,10 +195,15 @@ class PlaylistView : public QTreeView {
 
   void FadePreviousBackgroundImage(qreal value);
 
+  void TextDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
+  void ClearTextCache();
+
  private:
   void ReloadBarPixmaps();
   QList<QPixmap> LoadBarPixmap(const QString &filename);
   void UpdateCachedCurrentRowPixmap(QStyleOptionViewItem option, const QModelIndex &index);
+  void UpdatePaintStats(qint64 nsec);
+  static quint64 TextCacheKey(int row, int column);
 
   void set_background_image_type(BackgroundImageType bg) {
     background_image_type_ = bg;
@@ -205,6 +218,8 @@ class PlaylistView : public QTreeView {
   static const int kAutoscrollGraceTimeout;
   static const int kDropIndicatorWidth;
   static const int kDropIndicatorGradientWidth;
+  static const int kTextCacheSize;
+  static const int kPaintStatsInterval;
 
   QList<int> GetEditableColumns();
   QModelIndex NextEditableIndex(const QModelIndex &current);
@@ -270,6 +285,14 @@ class PlaylistView : public QTreeView {
   bool drag_over_;
 
   ColumnAlignmentMap column_alignment_;
+
+  mutable QCache<quint64, PlaylistDelegateBase::CachedText> text_cache_;
+
+  // Time spent drawing the rows, logged every kPaintStatsInterval msec.
+  QElapsedTimer paint_stats_timer_;
+  int paint_frames_;
+  qint64 paint_nsec_total_;
+  qint64 paint_nsec_max_;
 };
 
 #endif  // PLAYLISTVIEW_H
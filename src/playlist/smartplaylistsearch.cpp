@@ -0,0 +1,309 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QIODevice>
+#include <QDataStream>
+#include <QByteArray>
+#include <QDateTime>
+#include <QVariant>
+#include <QString>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionquery.h"
+#include "smartplaylistsearch.h"
+
+const char *SmartPlaylistSearch::kSpecialType = "smart";
+const quint32 SmartPlaylistSearch::kDataVersion = 1;
+
+// sqlite's LIKE only ignores the case of ASCII letters, so Matches() folds the same letters and nothing else.
+static QString FoldAsciiCase(const QString &text) {
+
+  QString ret = text;
+  for (int i = 0 ; i < ret.length() ; ++i) {
+    const ushort c = ret.at(i).unicode();
+    if (c >= 'A' && c <= 'Z') ret[i] = QChar(c + ('a' - 'A'));
+  }
+  return ret;
+
+}
+
+SmartPlaylistSearchTerm::SmartPlaylistSearchTerm() : field_(Field_Genre), op_(Op_Equals) {}
+
+SmartPlaylistSearchTerm::SmartPlaylistSearchTerm(Field field, Operator op, const QVariant &value, const QVariant &second_value)
+    : field_(field),
+      op_(op),
+      value_(value),
+      second_value_(second_value) {}
+
+bool SmartPlaylistSearchTerm::IsTextField(Field field) {
+
+  switch (field) {
+    case Field_Genre:
+    case Field_Artist:
+    case Field_AlbumArtist:
+    case Field_Album:
+      return true;
+    default:
+      return false;
+  }
+
+}
+
+bool SmartPlaylistSearchTerm::IsDateField(Field field) {
+  return field == Field_LastPlayed || field == Field_DateCreated;
+}
+
+QString SmartPlaylistSearchTerm::FieldColumnName(Field field) {
+
+  switch (field) {
+    case Field_Genre:       return "genre";
+    case Field_Artist:      return "artist";
+    case Field_AlbumArtist: return "albumartist";
+    case Field_Album:       return "album";
+    case Field_Year:        return "year";
+    case Field_PlayCount:   return "playcount";
+    case Field_SkipCount:   return "skipcount";
+    case Field_LastPlayed:  return "lastplayed";
+    case Field_DateCreated: return "ctime";
+  }
+  return QString();
+
+}
+
+bool SmartPlaylistSearchTerm::is_valid() const {
+
+  if (FieldColumnName(field_).isEmpty() || value_.isNull()) return false;
+
+  switch (op_) {
+    case Op_Contains:
+      return IsTextField(field_);
+    case Op_AtLeast:
+    case Op_AtMost:
+      return !IsTextField(field_);
+    case Op_Between:
+      return !IsTextField(field_) && !second_value_.isNull();
+    case Op_InLastDays:
+    case Op_NotInLastDays:
+      return IsDateField(field_);
+    default:
+      return true;
+  }
+
+}
+
+uint SmartPlaylistSearchTerm::Cutoff(uint now) const {
+
+  const qint64 seconds = qint64(value_.toInt()) * 60 * 60 * 24;
+  return seconds >= now ? 0 : uint(now - seconds);
+
+}
+
+void SmartPlaylistSearchTerm::AddToQuery(CollectionQuery *query, uint now) const {
+
+  const QString column = FieldColumnName(field_);
+
+  // Numbers have to be ints so CollectionQuery puts them inline.
+  const QVariant value = IsTextField(field_) ? QVariant(value_.toString()) : QVariant(value_.toInt());
+
+  switch (op_) {
+    case Op_Equals:
+      query->AddWhere(column, value);
+      break;
+    case Op_NotEquals:
+      query->AddWhere(column, value, "!=");
+      break;
+    case Op_Contains:
+      query->AddWhereContains(column, value_.toString());
+      break;
+    case Op_AtLeast:
+      query->AddWhere(column, value, ">=");
+      break;
+    case Op_AtMost:
+      query->AddWhere(column, value, "<=");
+      break;
+    case Op_Between:
+      query->AddWhere(column, value, ">=");
+      query->AddWhere(column, second_value_.toInt(), "<=");
+      break;
+    case Op_InLastDays:
+      query->AddWhere(column, int(Cutoff(now)), ">=");
+      break;
+    case Op_NotInLastDays:
+      query->AddWhere(column, int(Cutoff(now)), "<");
+      break;
+  }
+
+}
+
+QVariant SmartPlaylistSearchTerm::FieldValue(const Song &song) const {
+
+  switch (field_) {
+    case Field_Genre:       return song.genre();
+    case Field_Artist:      return song.artist();
+    case Field_AlbumArtist: return song.albumartist();
+    case Field_Album:       return song.album();
+    case Field_Year:        return song.year();
+    case Field_PlayCount:   return song.playcount();
+    case Field_SkipCount:   return song.skipcount();
+    case Field_LastPlayed:  return song.lastplayed();
+    case Field_DateCreated: return song.ctime();
+  }
+  return QVariant();
+
+}
+
+bool SmartPlaylistSearchTerm::Matches(const Song &song, uint now) const {
+
+  const QVariant field_value = FieldValue(song);
+
+  if (IsTextField(field_)) {
+    const QString text = field_value.toString();
+    switch (op_) {
+      case Op_Equals:    return text == value_.toString();
+      case Op_NotEquals: return text != value_.toString();
+      case Op_Contains:  return FoldAsciiCase(text).contains(FoldAsciiCase(value_.toString()));
+      default:           return false;
+    }
+  }
+
+  const qint64 number = field_value.toLongLong();
+  switch (op_) {
+    case Op_Equals:        return number == value_.toInt();
+    case Op_NotEquals:     return number != value_.toInt();
+    case Op_AtLeast:       return number >= value_.toInt();
+    case Op_AtMost:        return number <= value_.toInt();
+    case Op_Between:       return number >= value_.toInt() && number <= second_value_.toInt();
+    case Op_InLastDays:    return number >= qint64(Cutoff(now));
+    case Op_NotInLastDays: return number < qint64(Cutoff(now));
+    default:               return false;
+  }
+
+}
+
+bool SmartPlaylistSearchTerm::operator==(const SmartPlaylistSearchTerm &other) const {
+  return field_ == other.field_ && op_ == other.op_ && value_ == other.value_ && second_value_ == other.second_value_;
+}
+
+QDataStream &operator<<(QDataStream &s, const SmartPlaylistSearchTerm &term) {
+  s << quint8(term.field_) << quint8(term.op_) << term.value_ << term.second_value_;
+  return s;
+}
+
+QDataStream &operator>>(QDataStream &s, SmartPlaylistSearchTerm &term) {
+
+  quint8 field = 0;
+  quint8 op = 0;
+  s >> field >> op >> term.value_ >> term.second_value_;
+  term.field_ = SmartPlaylistSearchTerm::Field(field);
+  term.op_ = SmartPlaylistSearchTerm::Operator(op);
+  return s;
+
+}
+
+SmartPlaylistSearch::SmartPlaylistSearch() {}
+
+SmartPlaylistSearch::SmartPlaylistSearch(const SmartPlaylistSearchTermList &terms) : terms_(terms) {}
+
+bool SmartPlaylistSearch::is_valid() const {
+
+  if (terms_.isEmpty()) return false;
+  for (const SmartPlaylistSearchTerm &term : terms_) {
+    if (!term.is_valid()) return false;
+  }
+  return true;
+
+}
+
+bool SmartPlaylistSearch::is_time_relative() const {
+
+  for (const SmartPlaylistSearchTerm &term : terms_) {
+    if (term.is_time_relative()) return true;
+  }
+  return false;
+
+}
+
+bool SmartPlaylistSearch::Matches(const Song &song, uint now) const {
+
+  // The query leaves out unavailable songs.
+  if (song.id() == -1 || song.is_unavailable()) return false;
+
+  for (const SmartPlaylistSearchTerm &term : terms_) {
+    if (!term.Matches(song, now)) return false;
+  }
+  return true;
+
+}
+
+SongList SmartPlaylistSearch::Run(CollectionBackend *backend) const {
+
+  SongList ret;
+  if (!is_valid()) return ret;
+
+  CollectionQuery query;
+  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+  query.SetOrderBy("artist, album, disc, track");
+
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  for (const SmartPlaylistSearchTerm &term : terms_) {
+    term.AddToQuery(&query, now);
+  }
+
+  QMutexLocker l(backend->db()->Mutex());
+  if (!backend->ExecQuery(&query)) return ret;
+
+  while (query.Next()) {
+    Song song;
+    song.InitFromQuery(query, true);
+    ret << song;
+  }
+
+  return ret;
+
+}
+
+QByteArray SmartPlaylistSearch::Serialise() const {
+
+  QByteArray ret;
+  QDataStream s(&ret, QIODevice::WriteOnly);
+  s << kDataVersion << terms_;
+  return ret;
+
+}
+
+SmartPlaylistSearch SmartPlaylistSearch::Deserialise(const QByteArray &data) {
+
+  QDataStream s(data);
+  quint32 version = 0;
+  s >> version;
+  if (version != kDataVersion) return SmartPlaylistSearch();
+
+  SmartPlaylistSearchTermList terms;
+  s >> terms;
+  if (s.status() != QDataStream::Ok) return SmartPlaylistSearch();
+
+  return SmartPlaylistSearch(terms);
+
+}
@@ -0,0 +1,136 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2018, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SMARTPLAYLISTSEARCH_H
+#define SMARTPLAYLISTSEARCH_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QList>
+#include <QByteArray>
+#include <QDataStream>
+#include <QVariant>
+#include <QString>
+
+#include "core/song.h"
+
+class CollectionBackend;
+class CollectionQuery;
+
+// One rule of a smart playlist, for example "genre contains rock" or "not played in the last 30 days".
+class SmartPlaylistSearchTerm {
+ public:
+  enum Field {
+    Field_Genre = 0,
+    Field_Artist,
+    Field_AlbumArtist,
+    Field_Album,
+    Field_Year,
+    Field_PlayCount,
+    Field_SkipCount,
+    Field_LastPlayed,
+    Field_DateCreated
+  };
+
+  enum Operator {
+    Op_Equals = 0,
+    Op_NotEquals,
+    // Text fields only.
+    Op_Contains,
+    Op_AtLeast,
+    Op_AtMost,
+    // Inclusive, value and second_value are the bounds.
+    Op_Between,
+    // Date fields only, value is a number of days.  Songs that were never played are never in the last days, but always not in them.
+    Op_InLastDays,
+    Op_NotInLastDays
+  };
+
+  SmartPlaylistSearchTerm();
+  SmartPlaylistSearchTerm(Field field, Operator op, const QVariant &value, const QVariant &second_value = QVariant());
+
+  Field field() const { return field_; }
+  Operator op() const { return op_; }
+  QVariant value() const { return value_; }
+  QVariant second_value() const { return second_value_; }
+
+  bool is_valid() const;
+  // True for the date operators, whose result changes with the current time even if the song doesn't.
+  bool is_time_relative() const { return op_ == Op_InLastDays || op_ == Op_NotInLastDays; }
+
+  // Adds the rule to the WHERE clause of the query.  now is the current time in seconds since the epoch, used by the date operators.
+  void AddToQuery(CollectionQuery *query, uint now) const;
+  // Returns true if the song matches the rule, the same way as the SQL added by AddToQuery.
+  bool Matches(const Song &song, uint now) const;
+
+  static bool IsTextField(Field field);
+  static bool IsDateField(Field field);
+  static QString FieldColumnName(Field field);
+
+  bool operator==(const SmartPlaylistSearchTerm &other) const;
+  bool operator!=(const SmartPlaylistSearchTerm &other) const { return !(*this == other); }
+
+ private:
+  QVariant FieldValue(const Song &song) const;
+  uint Cutoff(uint now) const;
+
+  Field field_;
+  Operator op_;
+  QVariant value_;
+  QVariant second_value_;
+
+  friend QDataStream &operator<<(QDataStream &s, const SmartPlaylistSearchTerm &term);
+  friend QDataStream &operator>>(QDataStream &s, SmartPlaylistSearchTerm &term);
+};
+
+typedef QList<SmartPlaylistSearchTerm> SmartPlaylistSearchTermList;
+
+// The rules of a smart playlist.  All rules have to match, because CollectionQuery joins its WHERE clauses with AND.
+// The search is run once in the database to fill the playlist, after that the playlist is kept up to date by matching the songs the collection changes against the rules.
+class SmartPlaylistSearch {
+ public:
+  SmartPlaylistSearch();
+  explicit SmartPlaylistSearch(const SmartPlaylistSearchTermList &terms);
+
+  // The special type of playlists that are filled from a search.
+  static const char *kSpecialType;
+  // Changed whenever the serialised format changes, older data is ignored.
+  static const quint32 kDataVersion;
+
+  const SmartPlaylistSearchTermList &terms() const { return terms_; }
+
+  bool is_valid() const;
+  bool is_time_relative() const;
+  bool Matches(const Song &song, uint now) const;
+
+  // Runs the search in the collection, ordered by artist, album, disc and track.  Blocks, so call it from a worker thread.
+  SongList Run(CollectionBackend *backend) const;
+
+  QByteArray Serialise() const;
+  static SmartPlaylistSearch Deserialise(const QByteArray &data);
+
+ private:
+  SmartPlaylistSearchTermList terms_;
+};
+
+QDataStream &operator<<(QDataStream &s, const SmartPlaylistSearchTerm &term);
+QDataStream &operator>>(QDataStream &s, SmartPlaylistSearchTerm &term);
+
+#endif  // SMARTPLAYLISTSEARCH_H
@@ -22,6 +22,9 @@
 
 #include <QtConcurrentRun>
 #include <QtAlgorithms>
+#include <QMetaObject>
+#include <QFuture>
+#include <QThreadPool>
 #include <QList>
 #include <QUrl>
 
@@ -32,14 +35,22 @@
 #include "playlist.h"
 #include "songloaderinserter.h"
 
+const int SongLoaderInserter::kMaxConcurrentProbes = 8;
+
 SongLoaderInserter::SongLoaderInserter(TaskManager *task_manager, CollectionBackendInterface *collection, const Player *player)
     : task_manager_(task_manager),
       destination_(nullptr),
       row_(-1),
       play_now_(true),
       enqueue_(false),
+      inserted_count_(0),
+      metadata_task_id_(-1),
       collection_(collection),
-      player_(player) {}
+      player_(player) {
+
+  probe_pool_.setMaxThreadCount(kMaxConcurrentProbes);
+
+}
 
 SongLoaderInserter::~SongLoaderInserter() { qDeleteAll(pending_); }
 
@@ -51,15 +62,16 @@ void SongLoaderInserter::Load(Playlist *destination, int row, bool play_now, boo
   enqueue_ = enqueue;
 
   connect(destination, SIGNAL(destroyed()), SLOT(DestinationDestroyed()));
-  connect(this, SIGNAL(PreloadFinished()), SLOT(InsertSongs()));
-  connect(this, SIGNAL(EffectiveLoadFinished(const SongList&)), destination, SLOT(UpdateItems(const SongList&)));
+  connect(this, SIGNAL(SongsPreloaded(SongList)), SLOT(InsertBatch(SongList)));
 
   for (const QUrl &url : urls) {
-    SongLoader *loader = new SongLoader(collection_, player_, this);
+    SongLoader *loader = new SongLoader(collection_, player_, task_manager_, this);
 
     SongLoader::Result ret = loader->Load(url);
 
     if (ret == SongLoader::BlockingLoadRequired) {
+      connect(loader, SIGNAL(PlaylistSongsLoaded(SongList)), SLOT(InsertBatch(SongList)));
+      connect(loader, SIGNAL(SongsMetadataLoaded(SongList)), SLOT(UpdateBatch(SongList)));
       pending_.append(loader);
       continue;
     }
@@ -91,7 +103,7 @@ void SongLoaderInserter::LoadAudioCD(Playlist *destination, int row, bool play_n
   play_now_ = play_now;
   enqueue_ = enqueue;
 
-  SongLoader *loader = new SongLoader(collection_, player_, this);
+  SongLoader *loader = new SongLoader(collection_, player_, task_manager_, this);
   NewClosure(loader, SIGNAL(AudioCDTracksLoaded()), this, SLOT(AudioCDTracksLoaded(SongLoader*)), loader);
   connect(loader, SIGNAL(LoadAudioCDFinished(bool)), SLOT(AudioCDTagsLoaded(bool)));
   qLog(Info) << "Loading audio CD...";
@@ -127,51 +139,80 @@ void SongLoaderInserter::AudioCDTagsLoaded(bool success) {
 
 void SongLoaderInserter::InsertSongs() {
   // Insert songs (that haven't been completely loaded) to allow user to see and play them while not loaded completely
-  if (destination_) {
-    destination_->InsertSongsOrCollectionItems(songs_, row_, play_now_, enqueue_);
-  }
+  InsertBatch(songs_);
+}
+
+void SongLoaderInserter::InsertBatch(const SongList &songs) {
+
+  if (!destination_ || songs.isEmpty()) return;
+
+  // Only the first batch can start playing.
+  const int row = row_ == -1 ? -1 : row_ + inserted_count_;
+  destination_->InsertSongsOrCollectionItems(songs, row, play_now_ && inserted_count_ == 0, enqueue_);
+  inserted_count_ += songs.count();
+
+}
+
+void SongLoaderInserter::UpdateBatch(const SongList &songs) {
+
+  if (metadata_task_id_ != -1) task_manager_->IncreaseTaskProgress(metadata_task_id_, songs.count());
+  if (destination_) destination_->UpdateItems(songs);
+
+}
+
+void SongLoaderInserter::MetadataLoadFinished() {
+
+  task_manager_->SetTaskFinished(metadata_task_id_);
+  deleteLater();
+
 }
 
 void SongLoaderInserter::AsyncLoad() {
 
+  // Insert the songs that are already loaded first, then the songs of each URL as soon as it's loaded.
+  // Playlists insert their songs in batches while they are parsed, see SongLoader::PlaylistSongsLoaded().
+  emit SongsPreloaded(songs_);
+
+  // Remote URLs spend most of their time waiting for the server, so probe all of them at the same time.
+  // Local URLs are loaded in order below, because playlists insert their songs while they are parsed.
+  QList<QFuture<void>> remote_loads;
+  for (SongLoader *loader : pending_) {
+    if (loader->url().scheme() == "file") remote_loads << QFuture<void>();
+    else remote_loads << QtConcurrent::run(&probe_pool_, loader, &SongLoader::LoadFilenamesBlocking);
+  }
+
   // First, quick load raw songs.
   int async_progress = 0;
   int async_load_id = task_manager_->StartTask(tr("Loading tracks"));
   task_manager_->SetTaskProgress(async_load_id, async_progress, pending_.count());
   for (int i = 0; i < pending_.count(); ++i) {
     SongLoader *loader = pending_[i];
-    loader->LoadFilenamesBlocking();
+    if (loader->url().scheme() == "file") loader->LoadFilenamesBlocking();
+    else remote_loads[i].waitForFinished();
     task_manager_->SetTaskProgress(async_load_id, ++async_progress);
     if (i == 0) {
-      // Load everything from the first song.
-      // It'll start playing as soon as we emit PreloadFinished, so it needs to have the duration set to show properly in the UI.
-      loader->LoadMetadataBlocking();
+      // Load the first song.
+      // It'll start playing as soon as we emit SongsPreloaded, so it needs to have the duration set to show properly in the UI.
+      loader->LoadFirstSongBlocking();
     }
-    songs_ << loader->songs();
+    emit SongsPreloaded(loader->songs());
   }
   task_manager_->SetTaskFinished(async_load_id);
-  emit PreloadFinished();
 
   // Songs are inserted in playlist, now load them completely.
-  async_progress = 0;
-  async_load_id = task_manager_->StartTask(tr("Loading tracks info"));
-  task_manager_->SetTaskProgress(async_load_id, async_progress, songs_.count());
-  SongList songs;
-  for (int i = 0; i < pending_.count(); ++i) {
-    SongLoader *loader = pending_[i];
-    if (i != 0) {
-      // We already did this earlier for the first song.
-      loader->LoadMetadataBlocking();
-    }
-    songs << loader->songs();
-    task_manager_->SetTaskProgress(async_load_id, songs.count());
+  // Each loader replaces the partially-loaded items by fully loaded ones in batches as the tags are read, see UpdateBatch().
+  int song_count = 0;
+  for (SongLoader *loader : pending_) {
+    song_count += loader->songs().count();
+  }
+  metadata_task_id_ = task_manager_->StartTask(tr("Loading tracks info"));
+  task_manager_->SetTaskProgress(metadata_task_id_, 0, song_count);
+  for (SongLoader *loader : pending_) {
+    loader->LoadMetadataBlocking();
   }
-  task_manager_->SetTaskFinished(async_load_id);
-
-  // Replace the partially-loaded items by the new ones, fully loaded.
-  emit EffectiveLoadFinished(songs);
 
-  deleteLater();
+  // The batches are queued to the UI thread, so finish the task after the last of them has been applied.
+  QMetaObject::invokeMethod(this, "MetadataLoadFinished", Qt::QueuedConnection);
 
 }
 
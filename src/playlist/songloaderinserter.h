@@ -26,6 +26,7 @@
 #include <stdbool.h>
 
 #include <QObject>
+#include <QThreadPool>
 #include <QList>
 #include <QString>
 #include <QUrl>
@@ -49,29 +50,39 @@ class SongLoaderInserter : public QObject {
 
 signals:
   void Error(const QString &message);
-  void PreloadFinished();
-  void EffectiveLoadFinished(const SongList &songs);
+  void SongsPreloaded(const SongList &songs);
 
  private slots:
   void DestinationDestroyed();
   void AudioCDTracksLoaded(SongLoader *loader);
   void AudioCDTagsLoaded(bool success);
   void InsertSongs();
+  // Inserts the songs after the ones inserted before.
+  void InsertBatch(const SongList &songs);
+  // Updates the inserted songs with their metadata.
+  void UpdateBatch(const SongList &songs);
+  void MetadataLoadFinished();
 
  private:
   void AsyncLoad();
 
  private:
+  static const int kMaxConcurrentProbes;
+
   TaskManager *task_manager_;
 
   Playlist *destination_;
   int row_;
   bool play_now_;
   bool enqueue_;
+  int inserted_count_;
+  int metadata_task_id_;
 
   SongList songs_;
 
   QList<SongLoader*> pending_;
+  // Used to probe remote URLs concurrently.
+  QThreadPool probe_pool_;
   CollectionBackendInterface *collection_;
   const Player *player_;
 };
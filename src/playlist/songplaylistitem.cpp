@@ -35,7 +35,7 @@ SongPlaylistItem::SongPlaylistItem(const Song &song)
     : PlaylistItem(Song::Source_LocalFile), song_(song) {}
 
 bool SongPlaylistItem::InitFromQuery(const SqlRow &query) {
-  song_.InitFromQuery(query, false, (Song::kColumns.count()+1));
+  song_.InitFromQuery(query, false);
   return true;
 }
 
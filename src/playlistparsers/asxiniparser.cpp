@@ -40,6 +40,7 @@ bool AsxIniParser::TryMagic(const QByteArray &data) const {
 SongList AsxIniParser::Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const {
 
   SongList ret;
+  SongList songs;
 
   while (!device->atEnd()) {
     QString line = QString::fromUtf8(device->readLine()).trimmed();
@@ -48,10 +49,15 @@ SongList AsxIniParser::Load(QIODevice *device, const QString &playlist_path, con
     QString value = line.mid(equals + 1);
 
     if (key.startsWith("ref")) {
-      Song song = LoadSong(value, 0, dir);
-      if (song.is_valid()) {
-        ret << song;
-      }
+      songs << UnloadedSong(value, 0, dir);
+    }
+  }
+
+  LoadSongs(&songs);
+
+  for (const Song &song : songs) {
+    if (song.is_valid()) {
+      ret << song;
     }
   }
 
@@ -64,9 +70,13 @@ void AsxIniParser::Save(const SongList &songs, QIODevice *device, const QDir &di
   QTextStream s(device);
   s << "[Reference]" << endl;
 
+  SaveTask task(this, songs.count());
+
+  // Use \n instead of endl, which flushes the stream for every line.
   int n = 1;
   for (const Song &song : songs) {
-    s << "Ref" << n << "=" << URLOrFilename(song.url(), dir, path_type) << endl;
+    task.SongSaved();
+    s << "Ref" << n << "=" << URLOrFilename(song.url(), dir, path_type) << "\n";
     ++n;
   }
 
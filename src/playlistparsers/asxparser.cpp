@@ -78,11 +78,23 @@ SongList ASXParser::Load(QIODevice *device, const QString &playlist_path, const
     return ret;
   }
 
+  SongList entries;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "entry")) {
-    Song song = ParseTrack(&reader, dir);
-    if (song.is_valid()) {
-      ret << song;
-    }
+    entries << ParseTrack(&reader, dir);
+  }
+
+  SongList songs = entries;
+  LoadSongs(&songs);
+
+  for (int i = 0 ; i < songs.count() ; ++i) {
+    Song &song = songs[i];
+    if (!song.is_valid()) continue;
+
+    // Override metadata with what was in the playlist
+    song.set_title(entries[i].title());
+    song.set_artist(entries[i].artist());
+    song.set_album(entries[i].album());
+    ret << song;
   }
   return ret;
 
@@ -119,9 +131,8 @@ Song ASXParser::ParseTrack(QXmlStreamReader *reader, const QDir &dir) const {
   }
 
 return_song:
-  Song song = LoadSong(ref, 0, dir);
-
-  // Override metadata with what was in the playlist
+  // Only the URL is resolved here, the metadata in the playlist is applied again after loading the songs.
+  Song song = UnloadedSong(ref, 0, dir);
   song.set_title(title);
   song.set_artist(artist);
   song.set_album(album);
@@ -131,6 +142,8 @@ return_song:
 
 void ASXParser::Save(const SongList &songs, QIODevice *device, const QDir&, Playlist::Path path_type) const {
 
+  SaveTask task(this, songs.count());
+
   QXmlStreamWriter writer(device);
   writer.setAutoFormatting(true);
   writer.setAutoFormattingIndent(2);
@@ -139,6 +152,7 @@ void ASXParser::Save(const SongList &songs, QIODevice *device, const QDir&, Play
     StreamElement asx("asx", &writer);
     writer.writeAttribute("version", "3.0");
     for (const Song &song : songs) {
+      task.SongSaved();
       StreamElement entry("entry", &writer);
       writer.writeTextElement("title", song.title());
       {
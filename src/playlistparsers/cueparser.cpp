@@ -22,7 +22,11 @@
 #include <QObject>
 #include <QIODevice>
 #include <QDir>
+#include <QFile>
+#include <QFileDevice>
 #include <QFileInfo>
+#include <QCache>
+#include <QMutex>
 #include <QDateTime>
 #include <QList>
 #include <QString>
@@ -54,11 +58,77 @@ const char *CueParser::kGenre = "genre";
 const char *CueParser::kDate = "date";
 const char *CueParser::kDisc = "discnumber";
 
+const int CueParser::kCacheSize = 200;
+
+QMutex CueParser::sCacheMutex;
+QCache<QString, CueParser::CueSheet> CueParser::sCache(CueParser::kCacheSize);
+
 CueParser::CueParser(CollectionBackendInterface *collection, QObject *parent)
     : ParserBase(collection, parent) {}
 
 SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const {
-  SongList ret;
+
+  CueSheet sheet;
+  if (!CachedSheet(playlist_path, &sheet)) {
+    sheet = ParseSheet(device, dir);
+    CacheSheet(playlist_path, sheet);
+  }
+
+  return LoadSheet(sheet, playlist_path, dir);
+
+}
+
+SongList CueParser::LoadFile(const QString &cue_path, const QDir &dir) const {
+
+  CueSheet sheet;
+  if (!CachedSheet(cue_path, &sheet)) {
+    QFile file(cue_path);
+    if (!file.open(QIODevice::ReadOnly)) return SongList();
+    sheet = ParseSheet(&file, dir);
+    CacheSheet(cue_path, sheet);
+  }
+
+  return LoadSheet(sheet, cue_path, dir);
+
+}
+
+bool CueParser::CachedSheet(const QString &cue_path, CueSheet *sheet) {
+
+  if (cue_path.isEmpty()) return false;
+
+  const QFileInfo info(cue_path);
+  if (!info.isFile()) return false;
+
+  QMutexLocker l(&sCacheMutex);
+  const CueSheet *cached = sCache.object(cue_path);
+  if (!cached || cached->mtime != info.lastModified() || cached->size != info.size()) return false;
+
+  *sheet = *cached;
+  return true;
+
+}
+
+void CueParser::CacheSheet(const QString &cue_path, const CueSheet &sheet) {
+
+  // Sheets not read from a file can't be validated later.
+  if (cue_path.isEmpty() || !sheet.mtime.isValid()) return;
+
+  QMutexLocker l(&sCacheMutex);
+  sCache.insert(cue_path, new CueSheet(sheet));
+
+}
+
+CueParser::CueSheet CueParser::ParseSheet(QIODevice *device, const QDir &dir) const {
+
+  CueSheet sheet;
+
+  // Remember the state of the file before reading it, so a change while reading makes the cached sheet invalid.
+  QFileDevice *file = qobject_cast<QFileDevice*>(device);
+  if (file) {
+    const QFileInfo info(file->fileName());
+    sheet.mtime = info.lastModified();
+    sheet.size = info.size();
+  }
 
   QTextStream text_stream(device);
   text_stream.setCodec(QTextCodec::codecForUtfText(device->peek(1024), QTextCodec::codecForName("UTF-8")));
@@ -67,8 +137,8 @@ SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const
   // read the first line already
   QString line = text_stream.readLine();
 
-  QList<CueEntry> entries;
-  int files = 0;
+  QList<CueEntry> &entries = sheet.entries;
+  int &files = sheet.files;
 
   // -- whole file
   while (!text_stream.atEnd()) {
@@ -115,7 +185,8 @@ SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const
       }
       else if (line_name == kFile) {
 
-        file = QDir::isAbsolutePath(line_value) ? line_value : dir.absoluteFilePath(line_value);
+        // Relative paths are resolved when the songs are loaded.
+        file = line_value;
 
         if (splitted.size() > 2) {
           file_type = splitted[2];
@@ -153,7 +224,7 @@ SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const
 
     if(line.isNull()) {
       qLog(Warning) << "the .cue file from " << dir_path << " defines no tracks!";
-      return ret;
+      return CueSheet();
     }
 
     // if this is a data file, all of it's tracks will be ignored
@@ -231,13 +302,30 @@ SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const
     }
   }
 
+  return sheet;
+
+}
+
+SongList CueParser::LoadSheet(const CueSheet &sheet, const QString &playlist_path, const QDir &dir) const {
+
+  SongList ret;
+
+  const QList<CueEntry> &entries = sheet.entries;
   QDateTime cue_mtime = QFileInfo(playlist_path).lastModified();
 
+  // Load all songs at once
+  SongList songs;
+  for (const CueEntry &entry : entries) {
+    const QString file = QDir::isAbsolutePath(entry.file) ? entry.file : dir.absoluteFilePath(entry.file);
+    songs << UnloadedSong(file, IndexToMarker(entry.index), dir);
+  }
+  LoadSongs(&songs);
+
   // Finalize parsing songs
   for (int i = 0; i < entries.length(); i++) {
     CueEntry entry = entries.at(i);
 
-    Song song = LoadSong(entry.file, IndexToMarker(entry.index), dir);
+    Song song = songs[i];
 
     // Cue song has mtime equal to qMax(media_file_mtime, cue_sheet_mtime)
     if (cue_mtime.isValid()) {
@@ -248,7 +336,7 @@ SongList CueParser::Load(QIODevice *device, const QString &playlist_path, const
     // Overwrite the stuff, we may have read from the file or collection, using the current .cue metadata
 
     // Set track number only in single-file mode
-    if (files == 1) {
+    if (sheet.files == 1) {
       song.set_track(i + 1);
     }
 
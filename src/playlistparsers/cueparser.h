@@ -29,7 +29,11 @@
 #include <QObject>
 #include <QIODevice>
 #include <QByteArray>
+#include <QDateTime>
 #include <QDir>
+#include <QList>
+#include <QCache>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 
@@ -71,6 +75,10 @@ class CueParser : public ParserBase {
   SongList Load(QIODevice *device, const QString &playlist_path = "", const QDir &dir = QDir()) const;
   void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir(), Playlist::Path path_type = Playlist::Path_Automatic) const;
 
+  // Loads the songs of the .cue file at cue_path.
+  // Parsed sheets are kept in a cache shared by all parsers, so the file is only read again when its modification time or size changes.
+  SongList LoadFile(const QString &cue_path, const QDir &dir) const;
+
  private:
   // A single TRACK entry in .cue file.
   struct CueEntry {
@@ -108,11 +116,33 @@ class CueParser : public ParserBase {
     }
   };
 
+  // The parsed contents of a .cue file, with the state of the file when it was read.
+  struct CueSheet {
+    CueSheet() : size(-1), files(0) {}
+
+    QDateTime mtime;
+    qint64 size;
+    QList<CueEntry> entries;
+    int files;
+  };
+
+  static bool CachedSheet(const QString &cue_path, CueSheet *sheet);
+  static void CacheSheet(const QString &cue_path, const CueSheet &sheet);
+
+  CueSheet ParseSheet(QIODevice *device, const QDir &dir) const;
+  SongList LoadSheet(const CueSheet &sheet, const QString &playlist_path, const QDir &dir) const;
+
   bool UpdateSong(const CueEntry &entry, const QString &next_index, Song *song) const;
   bool UpdateLastSong(const CueEntry &entry, Song *song) const;
 
   QStringList SplitCueLine(const QString &line) const;
   qint64 IndexToMarker(const QString &index) const;
+
+  // Maximum number of parsed sheets kept in the cache.
+  static const int kCacheSize;
+
+  static QMutex sCacheMutex;
+  static QCache<QString, CueSheet> sCache;
 };
 
 #endif  // CUEPARSER_H
@@ -21,7 +21,6 @@
 #include <QObject>
 #include <QIODevice>
 #include <QDir>
-#include <QBuffer>
 #include <QByteArray>
 #include <QList>
 #include <QVariant>
@@ -39,28 +38,35 @@
 
 class CollectionBackendInterface;
 
+const int M3UParser::kWriteBufferSize = 65536;
+
 M3UParser::M3UParser(CollectionBackendInterface *collection, QObject *parent)
     : ParserBase(collection, parent) {}
 
 SongList M3UParser::Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const {
 
   SongList ret;
+  LoadStreaming(device, playlist_path, dir, [&ret](const SongList &songs) { ret << songs; });
+  return ret;
+
+}
+
+void M3UParser::LoadStreaming(QIODevice *device, const QString&, const QDir &dir, const SongsCallback &callback) const {
+
+  SongList songs;
+  QList<Metadata> metadata;
 
   M3UType type = STANDARD;
   Metadata current_metadata;
 
-  QString data = QString::fromUtf8(device->readAll());
-  data.replace('\r', '\n');
-  data.replace("\n\n", "\n");
-  QByteArray bytes = data.toUtf8();
-  QBuffer buffer(&bytes);
-  buffer.open(QIODevice::ReadOnly);
+  QByteArray bytes;
+  if (!ReadLine(device, &bytes)) return;
 
-  QString line = QString::fromUtf8(buffer.readLine()).trimmed();
+  QString line = QString::fromUtf8(bytes).trimmed();
   if (line.startsWith("#EXTM3U")) {
     // This is in extended M3U format.
     type = EXTENDED;
-    line = QString::fromUtf8(buffer.readLine()).trimmed();
+    line = ReadLine(device, &bytes) ? QString::fromUtf8(bytes).trimmed() : QString();
   }
 
   forever {
@@ -73,27 +79,65 @@ SongList M3UParser::Load(QIODevice *device, const QString &playlist_path, const
       }
     }
     else if (!line.isEmpty()) {
-      Song song = LoadSong(line, 0, dir);
-      if (!current_metadata.title.isEmpty()) {
-        song.set_title(current_metadata.title);
-      }
-      if (!current_metadata.artist.isEmpty()) {
-        song.set_artist(current_metadata.artist);
+      songs << UnloadedSong(line, 0, dir);
+      metadata << current_metadata;
+      if (songs.count() >= kStreamBatchSize) {
+        LoadBatch(&songs, &metadata, callback);
       }
-      if (current_metadata.length > 0) {
-        song.set_length_nanosec(current_metadata.length);
-      }
-      ret << song;
 
       current_metadata = Metadata();
     }
-    if (buffer.atEnd()) {
+    if (!ReadLine(device, &bytes)) {
       break;
     }
-    line = QString::fromUtf8(buffer.readLine()).trimmed();
+    line = QString::fromUtf8(bytes).trimmed();
   }
 
-  return ret;
+  LoadBatch(&songs, &metadata, callback);
+
+}
+
+void M3UParser::LoadBatch(SongList *songs, QList<Metadata> *metadata, const SongsCallback &callback) const {
+
+  if (songs->isEmpty()) return;
+
+  LoadSongs(songs);
+
+  for (int i = 0 ; i < songs->count() ; ++i) {
+    Song &song = (*songs)[i];
+    const Metadata &song_metadata = metadata->at(i);
+    if (!song_metadata.title.isEmpty()) {
+      song.set_title(song_metadata.title);
+    }
+    if (!song_metadata.artist.isEmpty()) {
+      song.set_artist(song_metadata.artist);
+    }
+    if (song_metadata.length > 0) {
+      song.set_length_nanosec(song_metadata.length);
+    }
+  }
+
+  callback(*songs);
+  songs->clear();
+  metadata->clear();
+
+}
+
+bool M3UParser::ReadLine(QIODevice *device, QByteArray *line) {
+
+  line->clear();
+
+  char c = 0;
+  while (device->getChar(&c)) {
+    if (c == '\n' || c == '\r') {
+      if (!line->isEmpty()) return true;
+    }
+    else {
+      line->append(c);
+    }
+  }
+
+  return !line->isEmpty();
 
 }
 
@@ -130,7 +174,12 @@ void M3UParser::Save(const SongList &songs, QIODevice *device, const QDir &dir,
   bool writeMetadata = s.value(Playlist::kWriteMetadata, true).toBool();
   s.endGroup();
 
+  SaveTask task(this, songs.count());
+
+  // Write in blocks instead of going through the device for every line.
+  QByteArray buffer;
   for (const Song &song : songs) {
+    task.SongSaved();
     if (song.url().isEmpty()) {
       continue;
     }
@@ -139,11 +188,18 @@ void M3UParser::Save(const SongList &songs, QIODevice *device, const QDir &dir,
                          .arg(song.length_nanosec() / kNsecPerSec)
                          .arg(song.artist())
                          .arg(song.title());
-      device->write(meta.toUtf8());
+      buffer.append(meta.toUtf8());
+    }
+    buffer.append(URLOrFilename(song.url(), dir, path_type).toUtf8());
+    buffer.append('\n');
+
+    if (buffer.size() >= kWriteBufferSize) {
+      device->write(buffer);
+      buffer.clear();
     }
-    device->write(URLOrFilename(song.url(), dir, path_type).toUtf8());
-    device->write("\n");
   }
+  device->write(buffer);
+
 }
 
 bool M3UParser::TryMagic(const QByteArray &data) const {
@@ -52,9 +52,13 @@ class M3UParser : public ParserBase {
   bool TryMagic(const QByteArray &data) const;
 
   SongList Load(QIODevice *device, const QString &playlist_path = "", const QDir &dir = QDir()) const;
+  void LoadStreaming(QIODevice *device, const QString &playlist_path, const QDir &dir, const SongsCallback &callback) const;
   void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir(), Playlist::Path path_type = Playlist::Path_Automatic) const;
 
  private:
+  // Saved lines are collected up to this many bytes before they are written.
+  static const int kWriteBufferSize;
+
   enum M3UType {
     STANDARD = 0,
     EXTENDED,  // Includes extended info (track, artist, etc.)
@@ -69,6 +73,10 @@ class M3UParser : public ParserBase {
   };
 
   bool ParseMetadata(const QString &line, Metadata *metadata) const;
+  void LoadBatch(SongList *songs, QList<Metadata> *metadata, const SongsCallback &callback) const;
+
+  // Reads the next non-empty line, accepting both \n and \r as line endings.
+  static bool ReadLine(QIODevice *device, QByteArray *line);
 
 };
 
@@ -20,6 +20,11 @@
 
 #include <QtGlobal>
 #include <QDir>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
 #include <QFile>
 #include <QFileInfo>
 #include <QString>
@@ -28,16 +33,42 @@
 
 #include "collection/collectionbackend.h"
 #include "core/tagreaderclient.h"
+#include "core/taskmanager.h"
 #include "parserbase.h"
 #include "playlist/playlist.h"
 
+const int ParserBase::kMaxPendingReads = 64;
+const int ParserBase::kStreamBatchSize = 1000;
+const int ParserBase::kSaveProgressInterval = 1000;
+
 ParserBase::ParserBase(CollectionBackendInterface *collection, QObject *parent)
-    : QObject(parent), collection_(collection) {}
+    : QObject(parent), collection_(collection), task_manager_(nullptr) {}
 
-void ParserBase::LoadSong(const QString &filename_or_url, qint64 beginning, const QDir &dir, Song *song) const {
+ParserBase::SaveTask::SaveTask(const ParserBase *parser, int count)
+    : task_manager_(parser->task_manager_),
+      task_id_(-1),
+      progress_(0) {
+
+  if (task_manager_) {
+    task_id_ = task_manager_->StartTask(tr("Saving playlist"));
+    task_manager_->SetTaskProgress(task_id_, 0, count);
+  }
+
+}
+
+ParserBase::SaveTask::~SaveTask() {
+  if (task_id_ != -1) task_manager_->SetTaskFinished(task_id_);
+}
 
+void ParserBase::SaveTask::SongSaved() {
+  if (task_id_ != -1 && ++progress_ % kSaveProgressInterval == 0) task_manager_->SetTaskProgress(task_id_, progress_);
+}
+
+Song ParserBase::UnloadedSong(const QString &filename_or_url, qint64 beginning, const QDir &dir) const {
+
+  Song song;
   if (filename_or_url.isEmpty()) {
-    return;
+    return song;
   }
 
   QString filename = filename_or_url;
@@ -70,7 +101,19 @@ void ParserBase::LoadSong(const QString &filename_or_url, qint64 beginning, cons
     filename = QFileInfo(filename).canonicalFilePath();
   }
 
-  const QUrl url = QUrl::fromLocalFile(filename);
+  song.set_url(QUrl::fromLocalFile(filename));
+  song.set_beginning_nanosec(beginning);
+  return song;
+
+}
+
+void ParserBase::LoadSong(const QString &filename_or_url, qint64 beginning, const QDir &dir, Song *song) const {
+
+  if (filename_or_url.isEmpty()) {
+    return;
+  }
+
+  const QUrl url = UnloadedSong(filename_or_url, beginning, dir).url();
 
   // Search in the collection
   Song collection_song;
@@ -83,7 +126,7 @@ void ParserBase::LoadSong(const QString &filename_or_url, qint64 beginning, cons
     *song = collection_song;
   }
   else {
-    TagReaderClient::Instance()->ReadFileBlocking(filename, song);
+    TagReaderClient::Instance()->ReadFileBlocking(url.toLocalFile(), song);
   }
 
 }
@@ -96,6 +139,99 @@ Song ParserBase::LoadSong(const QString &filename_or_url, qint64 beginning, cons
 
 }
 
+void ParserBase::LoadSongs(SongList *songs) const {
+
+  if (songs->isEmpty()) return;
+
+  int task_id = -1;
+  if (task_manager_) {
+    task_id = task_manager_->StartTask(tr("Loading playlist"));
+    task_manager_->SetTaskProgress(task_id, 0, songs->count());
+  }
+  int progress = 0;
+
+  // Search for all songs in the collection at once.
+  QList<QUrl> urls;
+  QSet<QByteArray> encoded_urls;
+  for (const Song &song : *songs) {
+    const QByteArray encoded_url = song.url().toEncoded();
+    if (encoded_url.isEmpty() || encoded_urls.contains(encoded_url)) continue;
+    encoded_urls << encoded_url;
+    urls << song.url();
+  }
+
+  QHash<QPair<QByteArray, qint64>, Song> collection_songs;
+  if (collection_ && !urls.isEmpty()) {
+    for (const Song &song : collection_->GetSongsByUrls(urls)) {
+      collection_songs.insert(qMakePair(song.url().toEncoded(), song.beginning_nanosec()), song);
+    }
+  }
+
+  QList<int> misses;
+  for (int i = 0 ; i < songs->count() ; ++i) {
+    const Song &song = songs->at(i);
+    if (song.url().isEmpty()) {
+      ++progress;
+      continue;
+    }
+
+    const QPair<QByteArray, qint64> key = qMakePair(song.url().toEncoded(), song.beginning_nanosec());
+    if (collection_songs.contains(key)) {
+      (*songs)[i] = collection_songs[key];
+      ++progress;
+    }
+    else {
+      misses << i;
+    }
+  }
+
+  if (task_id != -1) task_manager_->SetTaskProgress(task_id, progress);
+
+  // Load the rest from disk.  Keep a number of files queued so all tagreader workers are busy.
+  QList<QPair<int, TagReaderReply*>> pending;
+  int next = 0;
+  while (next < misses.count() || !pending.isEmpty()) {
+    while (next < misses.count() && pending.count() < kMaxPendingReads) {
+      const int i = misses[next++];
+      pending << qMakePair(i, TagReaderClient::Instance()->ReadFile(songs->at(i).url().toLocalFile()));
+    }
+
+    QPair<int, TagReaderReply*> read = pending.takeFirst();
+    Song song;
+    if (read.second->WaitForFinished()) {
+      song.InitFromProtobuf(read.second->message().read_file_response().metadata());
+    }
+    read.second->deleteLater();
+    (*songs)[read.first] = song;
+
+    if (task_id != -1) task_manager_->SetTaskProgress(task_id, ++progress);
+  }
+
+  if (task_id != -1) task_manager_->SetTaskFinished(task_id);
+
+}
+
+void ParserBase::LoadStreaming(QIODevice *device, const QString &playlist_path, const QDir &dir, const SongsCallback &callback) const {
+
+  const SongList songs = Load(device, playlist_path, dir);
+  if (!songs.isEmpty()) callback(songs);
+
+}
+
+void ParserBase::LoadValidSongs(SongList *songs, const SongsCallback &callback) const {
+
+  LoadSongs(songs);
+
+  SongList valid_songs;
+  for (const Song &song : *songs) {
+    if (song.is_valid()) valid_songs << song;
+  }
+  songs->clear();
+
+  if (!valid_songs.isEmpty()) callback(valid_songs);
+
+}
+
 QString ParserBase::URLOrFilename(const QUrl &url, const QDir &dir, Playlist::Path path_type) const {
 
   if (url.scheme() != "file") return url.toString();
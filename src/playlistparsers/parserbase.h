@@ -22,6 +22,7 @@
 #define PARSERBASE_H
 
 #include <stdbool.h>
+#include <functional>
 
 #include <QtGlobal>
 #include <QObject>
@@ -37,6 +38,7 @@
 #include "playlist/playlist.h"
 
 class CollectionBackendInterface;
+class TaskManager;
 
 class ParserBase : public QObject {
   Q_OBJECT
@@ -50,6 +52,9 @@ class ParserBase : public QObject {
 
   virtual bool TryMagic(const QByteArray &data) const = 0;
 
+  // If set, LoadSongs() shows its progress as a task.
+  void set_task_manager(TaskManager *task_manager) { task_manager_ = task_manager; }
+
   // Loads all songs from playlist found at path 'playlist_path' in directory 'dir'.
   // The 'device' argument is an opened and ready to read from represantation of this playlist.
   // This method might not return all of the songs found in the playlist.
@@ -58,7 +63,34 @@ class ParserBase : public QObject {
   virtual SongList Load(QIODevice *device, const QString &playlist_path = "", const QDir &dir = QDir()) const = 0;
   virtual void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir(), Playlist::Path path_type = Playlist::Path_Automatic) const = 0;
 
+  typedef std::function<void(const SongList&)> SongsCallback;
+
+  // Same as Load(), but passes the songs to the callback in batches of up to kStreamBatchSize songs as they are parsed and loaded, so the songs can be used before the whole playlist is read.
+  // Parsers that can't read their format incrementally load the whole playlist with Load() and pass it as one batch.
+  virtual void LoadStreaming(QIODevice *device, const QString &playlist_path, const QDir &dir, const SongsCallback &callback) const;
+
+  static const int kStreamBatchSize;
+  // Number of songs between progress updates while saving.
+  static const int kSaveProgressInterval;
+
 protected:
+  // Shows the progress of Save() as a task while it exists, if a task manager is set.  Save() can run in any thread.
+  class SaveTask {
+   public:
+    SaveTask(const ParserBase *parser, int count);
+    ~SaveTask();
+
+    // Call once for every song written, the task is only updated every kSaveProgressInterval songs.
+    void SongSaved();
+
+   private:
+    TaskManager *task_manager_;
+    int task_id_;
+    int progress_;
+
+    Q_DISABLE_COPY(SaveTask);
+  };
+
   // Loads a song.  If filename_or_url is a URL (with a scheme other than "file") then it is set on the song and the song marked as a stream.
   // If it is a filename or a file:// URL then it is made absolute and canonical and set as a file:// url on the song.
   // Also sets the song's metadata by searching in the Collection, or loading from the file as a fallback.
@@ -66,12 +98,25 @@ protected:
   Song LoadSong(const QString &filename_or_url, qint64 beginning, const QDir &dir) const;
   void LoadSong(const QString &filename_or_url, qint64 beginning, const QDir &dir, Song *song) const;
 
+  // Two phase loading for playlists with many entries: parse all entries with UnloadedSong() first, then load the metadata of all of them with LoadSongs().
+  // UnloadedSong() makes the path absolute and canonical like LoadSong(), but only sets the URL and beginning of the song.
+  Song UnloadedSong(const QString &filename_or_url, qint64 beginning, const QDir &dir) const;
+  // Searches for all songs in the collection with one query and reads the rest from the files through the tagreader workers concurrently.
+  // Songs without a URL are left as they are.
+  void LoadSongs(SongList *songs) const;
+  // Loads the songs with LoadSongs(), passes the valid ones to the callback and clears the list.
+  void LoadValidSongs(SongList *songs, const SongsCallback &callback) const;
+
   // If the URL is a file:// URL then returns its path, absolute or relative to the directory depending on the path_type option.
   // Otherwise returns the URL as is. This function should always be used when saving a playlist.
   QString URLOrFilename(const QUrl &url, const QDir &dir, Playlist::Path path_type) const;
 
 private:
+  // Maximum number of files waiting to be read by the tagreader workers.
+  static const int kMaxPendingReads;
+
   CollectionBackendInterface *collection_;
+  TaskManager *task_manager_;
 };
 
 #endif  // PARSERBASE_H
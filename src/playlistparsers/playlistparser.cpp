@@ -23,6 +23,7 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QByteArray>
 #include <QString>
 #include <QStringBuilder>
@@ -60,6 +61,14 @@ PlaylistParser::PlaylistParser(CollectionBackendInterface *collection, QObject *
 
 }
 
+void PlaylistParser::set_task_manager(TaskManager *task_manager) {
+
+  for (ParserBase *parser : parsers_) {
+    parser->set_task_manager(task_manager);
+  }
+
+}
+
 QStringList PlaylistParser::file_extensions() const {
 
   QStringList ret;
@@ -181,7 +190,7 @@ SongList PlaylistParser::LoadFromDevice(QIODevice *device, const QString &path_h
 
 }
 
-void PlaylistParser::Save(const SongList &songs, const QString &filename, Playlist::Path path_type) const {
+bool PlaylistParser::Save(const SongList &songs, const QString &filename, Playlist::Path path_type) const {
 
   QFileInfo info(filename);
 
@@ -189,13 +198,23 @@ void PlaylistParser::Save(const SongList &songs, const QString &filename, Playli
   ParserBase *parser = ParserForExtension(info.suffix());
   if (!parser) {
     qLog(Warning) << "Unknown filetype:" << filename;
-    return;
+    return false;
   }
 
-  // Open the file
-  QFile file(filename);
-  file.open(QIODevice::WriteOnly);
+  // Write to a temporary file that replaces the playlist when it's complete, so a failed save doesn't leave a truncated playlist behind.
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qLog(Warning) << "Failed to open" << filename << file.errorString();
+    return false;
+  }
+
+  parser->Save(songs, &file, info.absolutePath(), path_type);
+
+  if (!file.commit()) {
+    qLog(Warning) << "Failed to save" << filename << file.errorString();
+    return false;
+  }
 
-  return parser->Save(songs, &file, info.absolutePath(), path_type);
+  return true;
 
 }
@@ -35,6 +35,7 @@
 
 class CollectionBackendInterface;
 class ParserBase;
+class TaskManager;
 
 class PlaylistParser : public QObject {
   Q_OBJECT
@@ -44,6 +45,9 @@ class PlaylistParser : public QObject {
 
   static const int kMagicSize;
 
+  // Shows the progress of loading the songs of large playlists as a task.
+  void set_task_manager(TaskManager *task_manager);
+
   QStringList file_extensions() const;
   QString filters() const;
 
@@ -58,7 +62,8 @@ class PlaylistParser : public QObject {
 
   SongList LoadFromFile(const QString &filename) const;
   SongList LoadFromDevice(QIODevice *device, const QString &path_hint = QString(), const QDir &dir_hint = QDir()) const;
-  void Save(const SongList &songs, const QString &filename, Playlist::Path) const;
+  // Writes the playlist to a temporary file first and replaces the file with it when done.  Can be called from any thread.
+  bool Save(const SongList &songs, const QString &filename, Playlist::Path) const;
 
 private:
   QString FilterForParser(const ParserBase *parser, QStringList *all_extensions = nullptr) const;
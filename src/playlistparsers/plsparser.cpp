@@ -52,12 +52,11 @@ SongList PLSParser::Load(QIODevice *device, const QString &playlist_path, const
     int n = n_re.cap(0).toInt();
 
     if (key.startsWith("file")) {
-      Song song = LoadSong(value, 0, dir);
+      Song song = UnloadedSong(value, 0, dir);
 
-      // Use the title and length we've already loaded if any
-      if (!songs[n].title().isEmpty()) song.set_title(songs[n].title());
-      if (songs[n].length_nanosec() != -1)
-        song.set_length_nanosec(songs[n].length_nanosec());
+      // Keep the title and length we've already parsed if any
+      song.set_title(songs[n].title());
+      song.set_length_nanosec(songs[n].length_nanosec());
 
       songs[n] = song;
     }
@@ -72,7 +71,17 @@ SongList PLSParser::Load(QIODevice *device, const QString &playlist_path, const
     }
   }
 
-  return songs.values();
+  SongList entries = songs.values();
+  SongList ret = entries;
+  LoadSongs(&ret);
+
+  // Use the title and length from the playlist if any
+  for (int i = 0 ; i < ret.count() ; ++i) {
+    if (!entries[i].title().isEmpty()) ret[i].set_title(entries[i].title());
+    if (entries[i].length_nanosec() != -1) ret[i].set_length_nanosec(entries[i].length_nanosec());
+  }
+
+  return ret;
 
 }
 
@@ -83,11 +92,15 @@ void PLSParser::Save(const SongList &songs, QIODevice *device, const QDir &dir,
   s << "Version=2" << endl;
   s << "NumberOfEntries=" << songs.count() << endl;
 
+  SaveTask task(this, songs.count());
+
+  // Use \n instead of endl, which flushes the stream for every line.
   int n = 1;
   for (const Song &song : songs) {
-    s << "File" << n << "=" << URLOrFilename(song.url(), dir, path_type) << endl;
-    s << "Title" << n << "=" << song.title() << endl;
-    s << "Length" << n << "=" << song.length_nanosec() / kNsecPerSec << endl;
+    task.SongSaved();
+    s << "File" << n << "=" << URLOrFilename(song.url(), dir, path_type) << "\n";
+    s << "Title" << n << "=" << song.title() << "\n";
+    s << "Length" << n << "=" << song.length_nanosec() / kNsecPerSec << "\n";
     ++n;
   }
 
@@ -43,20 +43,28 @@ bool WplParser::TryMagic(const QByteArray &data) const {
 SongList WplParser::Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const {
 
   SongList ret;
+  LoadStreaming(device, playlist_path, dir, [&ret](const SongList &songs) { ret << songs; });
+  return ret;
+
+}
+
+void WplParser::LoadStreaming(QIODevice *device, const QString&, const QDir &dir, const SongsCallback &callback) const {
 
   QXmlStreamReader reader(device);
   if (!Utilities::ParseUntilElement(&reader, "smil") || !Utilities::ParseUntilElement(&reader, "body")) {
-    return ret;
+    return;
   }
 
+  SongList songs;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "seq")) {
-    ParseSeq(dir, &reader, &ret);
+    ParseSeq(dir, &reader, &songs, callback);
   }
-  return ret;
+
+  LoadValidSongs(&songs, callback);
 
 }
 
-void WplParser::ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *songs) const {
+void WplParser::ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *songs, const SongsCallback &callback) const {
 
   while (!reader->atEnd()) {
     QXmlStreamReader::TokenType type = reader->readNext();
@@ -66,9 +74,9 @@ void WplParser::ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *so
         if (name == "media") {
           QStringRef src = reader->attributes().value("src");
           if (!src.isEmpty()) {
-            Song song = LoadSong(src.toString(), 0, dir);
-            if (song.is_valid()) {
-              songs->append(song);
+            songs->append(UnloadedSong(src.toString(), 0, dir));
+            if (songs->count() >= kStreamBatchSize) {
+              LoadValidSongs(songs, callback);
             }
           }
         } else {
@@ -91,6 +99,8 @@ void WplParser::ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *so
 
 void WplParser::Save(const SongList &songs, QIODevice *device, const QDir &dir, Playlist::Path path_type) const {
 
+  SaveTask task(this, songs.count());
+
   QXmlStreamWriter writer(device);
   writer.setAutoFormatting(true);
   writer.setAutoFormattingIndent(2);
@@ -109,6 +119,7 @@ void WplParser::Save(const SongList &songs, QIODevice *device, const QDir &dir,
     {
       StreamElement seq("seq", &writer);
       for (const Song &song : songs) {
+        task.SongSaved();
         writer.writeStartElement("media");
         writer.writeAttribute("src", URLOrFilename(song.url(), dir, path_type));
         writer.writeEndElement();
@@ -50,10 +50,11 @@ class WplParser : public XMLParser {
   bool TryMagic(const QByteArray &data) const;
 
   SongList Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const;
+  void LoadStreaming(QIODevice *device, const QString &playlist_path, const QDir &dir, const SongsCallback &callback) const;
   void Save(const SongList &songs, QIODevice *device, const QDir &dir, Playlist::Path path_type = Playlist::Path_Automatic) const;
 
 private:
-  void ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *songs) const;
+  void ParseSeq(const QDir &dir, QXmlStreamReader *reader, SongList *songs, const SongsCallback &callback) const;
   void WriteMeta(const QString &name, const QString &content, QXmlStreamWriter *writer) const;
 };
 
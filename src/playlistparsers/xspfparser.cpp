@@ -43,20 +43,54 @@ XSPFParser::XSPFParser(CollectionBackendInterface *collection, QObject *parent)
     : XMLParser(collection, parent) {}
 
 SongList XSPFParser::Load(QIODevice *device, const QString &playlist_path, const QDir &dir) const {
+
   SongList ret;
+  LoadStreaming(device, playlist_path, dir, [&ret](const SongList &songs) { ret << songs; });
+  return ret;
+
+}
+
+void XSPFParser::LoadStreaming(QIODevice *device, const QString&, const QDir &dir, const SongsCallback &callback) const {
 
   QXmlStreamReader reader(device);
   if (!Utilities::ParseUntilElement(&reader, "playlist") || !Utilities::ParseUntilElement(&reader, "trackList")) {
-    return ret;
+    return;
   }
 
+  SongList tracks;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "track")) {
-    Song song = ParseTrack(&reader, dir);
-    if (song.is_valid()) {
-      ret << song;
+    tracks << ParseTrack(&reader, dir);
+    if (tracks.count() >= kStreamBatchSize) {
+      LoadTracks(&tracks, callback);
     }
   }
-  return ret;
+
+  LoadTracks(&tracks, callback);
+
+}
+
+void XSPFParser::LoadTracks(SongList *tracks, const SongsCallback &callback) const {
+
+  SongList songs = *tracks;
+  LoadSongs(&songs);
+
+  SongList ret;
+  for (int i = 0 ; i < songs.count() ; ++i) {
+    Song &song = songs[i];
+    if (!song.is_valid()) continue;
+
+    // Override metadata with what was in the playlist
+    const Song &track = tracks->at(i);
+    song.set_title(track.title());
+    song.set_artist(track.artist());
+    song.set_album(track.album());
+    song.set_length_nanosec(track.length_nanosec());
+    song.set_track(track.track());
+    ret << song;
+  }
+  tracks->clear();
+
+  if (!ret.isEmpty()) callback(ret);
 
 }
 
@@ -118,9 +152,8 @@ Song XSPFParser::ParseTrack(QXmlStreamReader *reader, const QDir &dir) const {
   }
 
 return_song:
-  Song song = LoadSong(location, 0, dir);
-
-  // Override metadata with what was in the playlist
+  // Only the URL is resolved here, the metadata in the playlist is applied again after loading the songs.
+  Song song = UnloadedSong(location, 0, dir);
   song.set_title(title);
   song.set_artist(artist);
   song.set_album(album);
@@ -146,8 +179,11 @@ void XSPFParser::Save(const SongList &songs, QIODevice *device, const QDir &dir,
   bool writeMetadata = s.value(Playlist::kWriteMetadata, true).toBool();
   s.endGroup();
 
+  SaveTask task(this, songs.count());
+
   StreamElement tracklist("trackList", &writer);
   for (const Song &song : songs) {
+    task.SongSaved();
     QString filename_or_url = URLOrFilename(song.url(), dir, path_type).toUtf8();
 
     StreamElement track("track", &writer);
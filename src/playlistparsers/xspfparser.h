@@ -51,10 +51,13 @@ class XSPFParser : public XMLParser {
   bool TryMagic(const QByteArray &data) const;
 
   SongList Load(QIODevice *device, const QString &playlist_path = "", const QDir &dir = QDir()) const;
+  void LoadStreaming(QIODevice *device, const QString &playlist_path, const QDir &dir, const SongsCallback &callback) const;
   void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir(), Playlist::Path path_type = Playlist::Path_Automatic) const;
 
  private:
   Song ParseTrack(QXmlStreamReader *reader, const QDir &dir) const;
+  // Loads the parsed tracks, applies the metadata from the playlist, passes the valid songs to the callback and clears the list.
+  void LoadTracks(SongList *tracks, const SongsCallback &callback) const;
 };
 
 #endif
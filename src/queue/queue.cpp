@@ -27,6 +27,7 @@
 #include <QDataStream>
 #include <QBuffer>
 #include <QFlags>
+#include <QHash>
 #include <QList>
 #include <QVariant>
 #include <QString>
@@ -46,7 +47,12 @@ using std::stable_sort;
 
 const char *Queue::kRowsMimetype = "application/x-strawberry-queue-rows";
 
-Queue::Queue(Playlist *parent) : QAbstractProxyModel(parent), playlist_(parent), total_length_ns_(0) {
+Queue::Queue(Playlist *parent) : QAbstractProxyModel(parent), row_positions_dirty_(false), playlist_(parent), total_length_ns_(0) {
+
+  // Any change to the queue itself makes the row positions invalid, except appending which is handled in ToggleTracks().
+  connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(InvalidateRowPositions()));
+  connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(InvalidateRowPositions()));
+  connect(this, SIGNAL(layoutChanged()), SLOT(InvalidateRowPositions()));
 
   connect(this, SIGNAL(ItemCountChanged(int)), SLOT(UpdateTotalLength()));
   connect(this, SIGNAL(TotalLengthChanged(quint64)), SLOT(UpdateSummaryText()));
@@ -59,21 +65,37 @@ QModelIndex Queue::mapFromSource(const QModelIndex &source_index) const {
 
   if (!source_index.isValid()) return QModelIndex();
 
-  const int source_row = source_index.row();
-  for (int i = 0; i < source_indexes_.count(); ++i) {
-    if (source_indexes_[i].row() == source_row)
-      return index(i, source_index.column());
-  }
-  return QModelIndex();
+  UpdateRowPositions();
+  QHash<int, int>::const_iterator it = row_positions_.constFind(source_index.row());
+  if (it == row_positions_.constEnd()) return QModelIndex();
+
+  return index(it.value(), source_index.column());
 
 }
 
 bool Queue::ContainsSourceRow(int source_row) const {
 
+  UpdateRowPositions();
+  return row_positions_.contains(source_row);
+
+}
+
+void Queue::InvalidateRowPositions() {
+  row_positions_dirty_ = true;
+}
+
+void Queue::UpdateRowPositions() const {
+
+  if (!row_positions_dirty_) return;
+
+  row_positions_.clear();
+  row_positions_.reserve(source_indexes_.count());
   for (int i = 0; i < source_indexes_.count(); ++i) {
-    if (source_indexes_[i].row() == source_row) return true;
+    const int source_row = source_indexes_[i].row();
+    // Keep the first position if a row is queued twice, like the linear search did.
+    if (source_row != -1 && !row_positions_.contains(source_row)) row_positions_.insert(source_row, i);
   }
-  return false;
+  row_positions_dirty_ = false;
 
 }
 
@@ -91,9 +113,19 @@ void Queue::setSourceModel(QAbstractItemModel *source_model) {
     disconnect(sourceModel(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
     disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(SourceLayoutChanged()));
     disconnect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(SourceLayoutChanged()));
+    disconnect(sourceModel(), nullptr, this, SLOT(InvalidateRowPositions()));
   }
 
   QAbstractProxyModel::setSourceModel(source_model);
+  InvalidateRowPositions();
+
+  // The source rows of the queued items change when rows are added, removed or moved in the source model.
+  // Connect these first, so the positions are invalid before anything else handles the change.
+  connect(sourceModel(), SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(InvalidateRowPositions()));
+  connect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(InvalidateRowPositions()));
+  connect(sourceModel(), SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(InvalidateRowPositions()));
+  connect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(InvalidateRowPositions()));
+  connect(sourceModel(), SIGNAL(modelReset()), this, SLOT(InvalidateRowPositions()));
 
   connect(sourceModel(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
   connect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(SourceLayoutChanged()));
@@ -103,13 +135,16 @@ void Queue::setSourceModel(QAbstractItemModel *source_model) {
 
 void Queue::SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right) {
 
+  bool queued_rows_changed = false;
   for (int row = top_left.row(); row <= bottom_right.row(); ++row) {
     QModelIndex proxy_index = mapFromSource(sourceModel()->index(row, 0));
     if (!proxy_index.isValid()) continue;
 
     emit dataChanged(proxy_index, proxy_index);
+    queued_rows_changed = true;
   }
-  emit ItemCountChanged(this->ItemCount());
+  // The total length only needs updating when one of the queued songs changed.
+  if (queued_rows_changed) emit ItemCountChanged(this->ItemCount());
 
 }
 
@@ -178,9 +213,15 @@ void Queue::ToggleTracks(const QModelIndexList &source_indexes) {
     else {
       // Enqueue the track
       const int row = source_indexes_.count();
+      const bool was_dirty = row_positions_dirty_;
       beginInsertRows(QModelIndex(), row, row);
       source_indexes_ << QPersistentModelIndex(source_index);
       endInsertRows();
+      // Appending doesn't move any other item, so just add it instead of rebuilding all positions.
+      if (!was_dirty) {
+        row_positions_.insert(source_index.row(), row);
+        row_positions_dirty_ = false;
+      }
     }
   }
 
@@ -28,6 +28,7 @@
 #include <QObject>
 #include <QAbstractItemModel>
 #include <QAbstractProxyModel>
+#include <QHash>
 #include <QList>
 #include <QVariant>
 #include <QString>
@@ -92,9 +93,17 @@ class Queue : public QAbstractProxyModel {
   void SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
   void SourceLayoutChanged();
   void UpdateTotalLength();
+  void InvalidateRowPositions();
+
+ private:
+  // Rebuilds row_positions_ if the queue or the rows in the source model changed since it was last built.
+  void UpdateRowPositions() const;
 
  private:
   QList<QPersistentModelIndex> source_indexes_;
+  // The position in the queue of each queued source row, so the playlist can look up rows without scanning the queue.
+  mutable QHash<int, int> row_positions_;
+  mutable bool row_positions_dirty_;
   const Playlist *playlist_;
   quint64 total_length_ns_;
 